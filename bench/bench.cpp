@@ -0,0 +1,494 @@
+// -*- C++ -*-
+// bench.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Microbenchmarks of loading, indexing, filtering and populating the
+// window. Runs offscreen and prints the mean and percentiles of every
+// case along with the heap allocations per iteration.
+//
+//     miniguide_bench [--iterations N] data.xml
+//     miniguide_bench [--iterations N] --synthetic 100 [--seed S]
+
+#include "diff.hpp"
+#include "disasm.hpp"
+#include "generator.hpp"
+#include "index.hpp"
+#include "mainwindow.hpp"
+#include "parser.hpp"
+#include "render.hpp"
+
+#include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QVector>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <cstdlib>
+#include <new>
+#include <numeric>
+
+// every operator new of the process goes through the counter
+static std::atomic<quint64> allocations{0};
+
+// results are stored here so the timed work is not optimized out
+static volatile qint64 sink = 0;
+
+void*
+operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if(void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void
+operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+struct Result
+{
+    QString         name;
+    QVector<qint64> samples; // nanoseconds
+    quint64         allocations = 0;
+};
+
+// Runs setup untimed and op timed the given number of times after a warm
+// up run. Op returns the number of items it processed, samples are per
+// item then.
+template <typename Setup, typename Op>
+Result
+measure(const QString& name, const int iterations, Setup&& setup, Op&& op)
+{
+    Result ret{name, {}, 0};
+    ret.samples.reserve(iterations);
+
+    setup();
+    op();
+
+    QElapsedTimer timer;
+    for(int n = 0; n < iterations; ++n)
+    {
+        setup();
+
+        const quint64 allocs = allocations.load(std::memory_order_relaxed);
+        timer.start();
+        const qint64 items = qMax<qint64>(1, op());
+        ret.samples.append(timer.nsecsElapsed() / items);
+        ret.allocations +=
+            (allocations.load(std::memory_order_relaxed) - allocs) / items;
+    }
+
+    ret.allocations /= qMax(1, iterations);
+
+    return ret;
+}
+
+template <typename Op>
+Result
+measure(const QString& name, const int iterations, Op&& op)
+{
+    return measure(name, iterations, []() {}, std::forward<Op>(op));
+}
+
+void
+report(QTextStream& out, Result result)
+{
+    std::sort(result.samples.begin(), result.samples.end());
+
+    const auto percentile = [&](const int p)
+    {
+        const int n = (result.samples.count() - 1) * p / 100;
+        return static_cast<double>(result.samples[n]) / 1000.0;
+    };
+
+    const double mean =
+        std::accumulate(result.samples.cbegin(), result.samples.cend(), 0.0) /
+        result.samples.count() / 1000.0;
+
+    out << qSetFieldWidth(28) << Qt::left << result.name
+        << qSetFieldWidth(12) << Qt::right << QString::number(mean, 'f', 2)
+        << QString::number(percentile(50), 'f', 2)
+        << QString::number(percentile(90), 'f', 2)
+        << QString::number(percentile(99), 'f', 2)
+        << QString::number(result.allocations) << qSetFieldWidth(0) << '\n';
+    out.flush();
+}
+
+ParseData
+load(const QString& path, const ParseOptions& options = {})
+{
+    QFile file(path);
+    return parse_doc(&file, options);
+}
+
+Query
+make_query(const QString& search,
+           const QString& ret      = "*",
+           const QString& tech     = {},
+           const QString& cpuid    = {},
+           const QString& category = {})
+{
+    Query query;
+    query.search = search;
+    query.ret    = ret;
+    if(!tech.isEmpty()) query.techs.insert(tech);
+    if(!cpuid.isEmpty()) query.cpuids.insert(cpuid);
+    if(!category.isEmpty()) query.categories.insert(category);
+    return query;
+}
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+    if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("MinIGuide microbenchmarks.");
+    parser.addHelpOption();
+    const QCommandLineOption iterations_opt(
+        "iterations", "Timed runs of every case.", "count", "20");
+    const QCommandLineOption synthetic_opt(
+        "synthetic",
+        "Benchmark generated data of the multiple of the real size.",
+        "scale");
+    const QCommandLineOption seed_opt(
+        "seed", "Seed of the generated data.", "seed", "1");
+    parser.addOptions({iterations_opt, synthetic_opt, seed_opt});
+    parser.addPositionalArgument("data", "Intrinsics data file.");
+    parser.process(app);
+
+    const bool synthetic = parser.isSet(synthetic_opt);
+    if(parser.positionalArguments().count() != (synthetic ? 0 : 1))
+        parser.showHelp(1);
+
+    const int     iterations = qMax(1, parser.value(iterations_opt).toInt());
+    QTemporaryDir synthetic_dir;
+    QString       data_path;
+    qint64        synthetic_count = 0;
+
+    if(synthetic)
+    {
+        GeneratorOptions options;
+        options.seed  = parser.value(seed_opt).toULongLong();
+        options.count = static_cast<qint64>(
+            parser.value(synthetic_opt).toDouble() * options.count);
+        synthetic_count = options.count;
+
+        data_path = synthetic_dir.filePath("data-synthetic.xml");
+        QFile file(data_path);
+        if(!file.open(QIODevice::WriteOnly) || !generate_data(&file, options))
+        {
+            QTextStream(stderr) << "Could not write " << data_path << '\n';
+            return 1;
+        }
+    }
+    else
+        data_path = parser.positionalArguments().front();
+
+    QTextStream out(stdout);
+
+    ParseData data;
+    try
+    {
+        data = load(data_path);
+    }
+    catch(const ParsingError& ex)
+    {
+        QTextStream(stderr) << "Failed to parse " << data_path << ": "
+                            << error_text(ex) << '\n';
+        return 1;
+    }
+
+    const Intrinsics& intrinsics = data.intrinsics;
+    const Symbols&    symbols    = *data.symbols;
+
+    // a scale past what the loader handles must not time garbage, every
+    // generated record is there and the texts of the last decode
+    if(synthetic)
+    {
+        const QString text =
+            intrinsics.isEmpty() ? QString() :
+                                   intrinsics.back().description.toString();
+        if(intrinsics.count() != synthetic_count ||
+           (synthetic_count > 0 && (!text.endsWith('.') || text.contains('<'))))
+        {
+            QTextStream(stderr)
+                << "Loaded " << intrinsics.count() << " of " << synthetic_count
+                << " generated intrinsics or corrupt texts from " << data_path
+                << '\n';
+            return 1;
+        }
+    }
+
+    out << intrinsics.count() << " intrinsics, " << iterations
+        << " iterations, times in microseconds\n";
+    out << qSetFieldWidth(28) << Qt::left << "case" << qSetFieldWidth(12)
+        << Qt::right << "mean"
+        << "p50"
+        << "p90"
+        << "p99"
+        << "allocs" << qSetFieldWidth(0) << '\n';
+
+    // loading
+    {
+        ParseOptions serial;
+        serial.threads = 1;
+
+        QTemporaryDir snapshot_dir;
+        ParseOptions  snapshot;
+        snapshot.snapshot_dir = snapshot_dir.path();
+
+        const auto parse = [&](const ParseOptions& options)
+        {
+            return [&data_path, options]() -> qint64
+            {
+                sink = load(data_path, options).intrinsics.count();
+                return 1;
+            };
+        };
+
+        report(out, measure("parse_doc serial", iterations, parse(serial)));
+        report(out, measure("parse_doc parallel", iterations, parse({})));
+        report(out, measure("parse_doc snapshot", iterations, parse(snapshot)));
+
+        // the first records of the file, parsed one by one
+        QVector<QByteArray> elements;
+        {
+            QFile file(data_path);
+            file.open(QIODevice::ReadOnly);
+            const QByteArray head = file.read(4 << 20);
+
+            static const QByteArray end_tag("</intrinsic>");
+            for(int begin = head.indexOf("<intrinsic ");
+                begin != -1 && elements.count() < 1000;
+                begin = head.indexOf("<intrinsic ", begin))
+            {
+                const int end = head.indexOf(end_tag, begin);
+                if(end == -1) break;
+                elements.append(
+                    head.mid(begin, end + end_tag.size() - begin));
+                begin = end;
+            }
+        }
+
+        Symbols symbols_of_elements;
+        report(out,
+               measure(
+                   "parse_intrinsic",
+                   iterations,
+                   [&]() { symbols_of_elements = Symbols(); },
+                   [&]() -> qint64
+                   {
+                       for(const QByteArray& element: elements)
+                       {
+                           const Intrinsic i =
+                               parse_intrinsic(element, symbols_of_elements);
+                           sink = i.tech;
+                       }
+                       return elements.count();
+                   }));
+    }
+
+    // tech families of every CPUID flag
+    {
+        const QStringList cpuids = symbols.cpuids.names();
+        report(out,
+               measure("cpuid_super",
+                       iterations,
+                       [&]() -> qint64
+                       {
+                           for(const QString& c: cpuids)
+                               sink = cpuid_super(c).size();
+                           return cpuids.count();
+                       }));
+    }
+
+    // indexing and filtering
+    {
+        report(out,
+               measure("FilterIndex build",
+                       iterations,
+                       [&]() -> qint64
+                       {
+                           sink = FilterIndex(intrinsics, data.symbols).count();
+                           return 1;
+                       }));
+
+        report(out,
+               measure("TextIndex build",
+                       iterations,
+                       [&]() -> qint64
+                       {
+                           sink = TextIndex(intrinsics)
+                                      .find("add", Bitset(intrinsics.count()))
+                                      .size();
+                           return 1;
+                       }));
+
+        const QVector<QPair<QString, Query>> queries{
+            {"filter all", make_query("")},
+            {"filter search short", make_query("add")},
+            {"filter search prefix", make_query("_mm256_")},
+            {"filter ret", make_query("", "__m256i")},
+            {"filter tech", make_query("", "*", "AVX2")},
+            {"filter cpuid+search", make_query("mask", "*", "", "AVX-512F")},
+            {"filter category", make_query("", "*", "", "", "Arithmetic")},
+            {"filter fuzzy", make_query("mm256addepi32")},
+            {"filter exact", make_query("'add_epi32")},
+            {"filter terms",
+             parse_query("ret:__m256i cpuid:AVX2 instr:vpadd* -tech:SVML")},
+            {"filter terms+search",
+             parse_query("param:__m256i cat:Arithmetic -tech:SVML add")},
+            {"filter signature",
+             parse_query("sig:(__m512i, __mmask16, const void*)")},
+            {"filter signature contains",
+             parse_query("ret:__m128d sig:\"int imm8\"")},
+            {"filter text", make_query("?horizontal add saturate")},
+            {"filter text+cpuid", parse_query("cpuid:AVX2 ?gather scale")}};
+
+        for(const auto& [name, query]: queries)
+        {
+            // a new index every time, the recent search cache would
+            // turn repeated searches into lookups; the text index is
+            // built in the background after loading
+            std::unique_ptr<FilterIndex> index;
+            const auto                   setup = [&]()
+            {
+                index =
+                    std::make_unique<FilterIndex>(intrinsics, data.symbols);
+                index->text();
+            };
+
+            report(out,
+                   measure(name,
+                           iterations,
+                           setup,
+                           [&]() -> qint64
+                           {
+                               sink = index->ranked(query).count();
+                               return 1;
+                           }));
+        }
+    }
+
+    // window population
+    {
+        std::unique_ptr<MainWindow> window;
+        report(out,
+               measure(
+                   "addIntrinsics",
+                   iterations,
+                   [&]() { window = std::make_unique<MainWindow>(); },
+                   [&]() -> qint64
+                   {
+                       window->addIntrinsics(intrinsics, data.symbols);
+                       return 1;
+                   }));
+    }
+
+    // details of every intrinsic
+    report(out,
+           measure("render_details",
+                   iterations,
+                   [&]() -> qint64
+                   {
+                       for(const Intrinsic& i: intrinsics)
+                           sink =
+                               render_details(i, symbols).operation.size();
+                       return intrinsics.count();
+                   }));
+
+    // objdump like listing of the instructions of the data
+    {
+        QStringList instructions;
+        for(const Intrinsic& i: intrinsics)
+            for(const Instruction& ins: i.instructions)
+                instructions.append(ins.name.toLower() + ' ' + ins.form);
+
+        QStringList listing;
+        for(int n = 0; !instructions.isEmpty() && n < 100000; ++n)
+            listing.append(QString("  %1:\tc5 fd fe c1\t%2")
+                               .arg(0x401000 + n * 4, 0, 16)
+                               .arg(instructions[n % instructions.count()]));
+
+        const InstructionIndex index(intrinsics);
+        report(out,
+               measure("disasm listing",
+                       iterations,
+                       [&]() -> qint64
+                       {
+                           DisasmReport disasm(index, intrinsics);
+                           for(const QString& line: listing)
+                               disasm.addLine(line);
+                           sink = disasm.instructions();
+                           return listing.count();
+                       }));
+    }
+
+    // a second load as the next version, short of some intrinsics, every
+    // pair has its texts compared
+    {
+        QVector<ParseData> versions{load(data_path), load(data_path)};
+        Intrinsics&        next = versions[1].intrinsics;
+        for(int n = next.count() - 1; n >= 0; n -= 97) next.remove(n);
+
+        report(out,
+               measure("share_symbols",
+                       iterations,
+                       [&]() -> qint64
+                       {
+                           QVector<ParseData> shared = versions;
+                           share_symbols(shared);
+                           return 1;
+                       }));
+
+        share_symbols(versions);
+        report(out,
+               measure("diff_intrinsics",
+                       iterations,
+                       [&]() -> qint64
+                       {
+                           sink = diff_intrinsics(versions[0].intrinsics,
+                                                  versions[1].intrinsics)
+                                      .removed.count();
+                           return 1;
+                       }));
+    }
+
+    return 0;
+}
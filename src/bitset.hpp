@@ -0,0 +1,163 @@
+// -*- C++ -*-
+// bitset.hpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <QVector>
+#include <QtAlgorithms>
+#include <QtGlobal>
+
+// Dynamically sized bitset over 64 bit words. Binary operations expect
+// operands of the same size.
+class Bitset
+{
+    QVector<quint64> m_words;
+    int              m_size = 0;
+
+    static constexpr int
+    wordsFor(const int size) noexcept
+    {
+        return (size + 63) / 64;
+    }
+
+    // clears the bits past the size in the last word
+    void
+    trim() noexcept
+    {
+        if(m_size % 64) m_words.last() &= (quint64(1) << (m_size % 64)) - 1;
+    }
+
+  public:
+    Bitset() = default;
+
+    explicit Bitset(const int size, const bool value = false) :
+        m_words(wordsFor(size), value ? ~quint64(0) : quint64(0)),
+        m_size(size)
+    {
+        if(value) trim();
+    }
+
+    int
+    size() const noexcept
+    {
+        return m_size;
+    }
+
+    int
+    wordCount() const noexcept
+    {
+        return m_words.count();
+    }
+
+    // bits wi * 64 to wi * 64 + 63
+    quint64
+    word(const int wi) const noexcept
+    {
+        return m_words[wi];
+    }
+
+    void
+    setWord(const int wi, const quint64 w) noexcept
+    {
+        m_words[wi] = w;
+    }
+
+    bool
+    test(const int i) const noexcept
+    {
+        return m_words[i / 64] >> (i % 64) & 1;
+    }
+
+    void
+    set(const int i) noexcept
+    {
+        m_words[i / 64] |= quint64(1) << (i % 64);
+    }
+
+    void
+    reset(const int i) noexcept
+    {
+        m_words[i / 64] &= ~(quint64(1) << (i % 64));
+    }
+
+    Bitset&
+    operator&=(const Bitset& other) noexcept
+    {
+        quint64*       w = m_words.data();
+        const quint64* o = other.m_words.constData();
+        for(int i = 0; i < m_words.count(); ++i) w[i] &= o[i];
+        return *this;
+    }
+
+    Bitset&
+    operator|=(const Bitset& other) noexcept
+    {
+        quint64*       w = m_words.data();
+        const quint64* o = other.m_words.constData();
+        for(int i = 0; i < m_words.count(); ++i) w[i] |= o[i];
+        return *this;
+    }
+
+    // clears the bits set in the other
+    Bitset&
+    andNot(const Bitset& other) noexcept
+    {
+        quint64*       w = m_words.data();
+        const quint64* o = other.m_words.constData();
+        for(int i = 0; i < m_words.count(); ++i) w[i] &= ~o[i];
+        return *this;
+    }
+
+    bool
+    operator==(const Bitset& other) const noexcept
+    {
+        return m_size == other.m_size && m_words == other.m_words;
+    }
+
+    bool
+    operator!=(const Bitset& other) const noexcept
+    {
+        return !(*this == other);
+    }
+
+    bool
+    any() const noexcept
+    {
+        for(const quint64 w: m_words)
+            if(w) return true;
+        return false;
+    }
+
+    int
+    count() const noexcept
+    {
+        int ret = 0;
+        for(const quint64 w: m_words) ret += qPopulationCount(w);
+        return ret;
+    }
+
+    // calls op with the index of every set bit in ascending order
+    template <typename Op>
+    void
+    forEach(Op&& op) const
+    {
+        for(int wi = 0; wi < m_words.count(); ++wi)
+            for(quint64 w = m_words[wi]; w; w &= w - 1)
+                op(wi * 64 + qCountTrailingZeroBits(w));
+    }
+};
@@ -0,0 +1,445 @@
+// -*- C++ -*-
+// cli.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "cli.hpp"
+#include "diff.hpp"
+#include "disasm.hpp"
+#include "render.hpp"
+#include "trace.hpp"
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+enum class Format
+{
+    TSV,
+    JSON
+};
+
+void
+print_matches(QTextStream&        out,
+              const Format        format,
+              const QVector<int>& matches,
+              const ParseData&    data,
+              const int           query_number)
+{
+    const Symbols& symbols = *data.symbols;
+
+    for(const int position: matches)
+    {
+        const Intrinsic& i = data.intrinsics[position];
+
+        if(format == Format::TSV)
+        {
+            out << i.name << '\t' << signature(i, symbols) << '\t'
+                << symbols.techs[i.tech] << '\t'
+                << symbols.categories[i.category] << '\t'
+                << symbols.headers[i.header] << '\t'
+                << symbols.cpuidNames(i.cpuids).join('+') << '\n';
+            continue;
+        }
+
+        QJsonObject obj = intrinsic_json(i, symbols);
+        if(query_number >= 0) obj.insert("query", query_number);
+
+        out << QJsonDocument(obj).toJson(QJsonDocument::Compact) << '\n';
+    }
+}
+
+// the data of the file, false with the error printed if it fails
+bool
+load_data(QFile*              data_file,
+          const ParseOptions& options,
+          QTextStream&        err,
+          ParseData&          data)
+{
+    try
+    {
+        data = parse_doc(data_file, options);
+    }
+    catch(const ParsingError& ex)
+    {
+        err << "Failed to parse " << data_file->fileName() << ": "
+            << error_text(ex) << '\n';
+        return false;
+    }
+
+    return true;
+}
+
+bool
+parse_format(const QString& name, QTextStream& err, Format& format)
+{
+    if(name != "tsv" && name != "json")
+    {
+        err << "Unknown format: " << name << '\n';
+        return false;
+    }
+
+    format = name == "json" ? Format::JSON : Format::TSV;
+    return true;
+}
+
+void
+print_report(QTextStream&        out,
+             const Format        format,
+             const DisasmReport& report,
+             const ParseData&    data)
+{
+    const Symbols& symbols = *data.symbols;
+
+    for(const DisasmReport::Entry& entry: report.entries())
+    {
+        const DisasmInstruction& ins = entry.instruction;
+        const QString            instruction =
+            ins.form.isEmpty() ? ins.mnemonic : ins.mnemonic + ' ' + ins.form;
+
+        QStringList names;
+        for(const int n: entry.match.intrinsics)
+            names.append(data.intrinsics[n].name);
+
+        if(format == Format::TSV)
+        {
+            out << entry.count << '\t' << instruction << '\t'
+                << symbols.cpuidNames(entry.cpuids).join('+') << '\t'
+                << names.join(',') << '\n';
+            continue;
+        }
+
+        QJsonObject obj;
+        obj.insert("count", entry.count);
+        obj.insert("instruction", instruction);
+        obj.insert("match",
+                   names.isEmpty()   ? "none" :
+                   entry.match.exact ? "form" :
+                                       "mnemonic");
+        obj.insert("cpuids",
+                   QJsonArray::fromStringList(
+                       symbols.cpuidNames(entry.cpuids)));
+        obj.insert("intrinsics", QJsonArray::fromStringList(names));
+        out << QJsonDocument(obj).toJson(QJsonDocument::Compact) << '\n';
+    }
+
+    const QStringList cpuids = symbols.cpuidNames(report.cpuids());
+    if(format == Format::TSV)
+    {
+        out << report.instructions() << "\ttotal\t" << cpuids.join('+')
+            << "\t\n";
+        return;
+    }
+
+    QJsonObject obj;
+    obj.insert("total", report.instructions());
+    obj.insert("lines", report.lines());
+    obj.insert("cpuids", QJsonArray::fromStringList(cpuids));
+    out << QJsonDocument(obj).toJson(QJsonDocument::Compact) << '\n';
+}
+
+// a change of the diff, from and to are positions in the versions or -1
+void
+print_change(QTextStream&     out,
+             const Format     format,
+             const QString&   change,
+             const ParseData& from_data,
+             const int        from,
+             const ParseData& to_data,
+             const int        to,
+             const int        fields)
+{
+    const Symbols&   symbols = *to_data.symbols;
+    const Intrinsic& i =
+        to != -1 ? to_data.intrinsics[to] : from_data.intrinsics[from];
+
+    if(format == Format::TSV)
+    {
+        out << from_data.version << '\t' << to_data.version << '\t' << change
+            << '\t' << i.name << '\t' << symbols.techs[i.tech] << '\t'
+            << symbols.cpuidNames(i.cpuids).join('+') << '\t'
+            << change_fields(fields).join(',') << '\n';
+        return;
+    }
+
+    QJsonObject obj = intrinsic_json(i, symbols);
+    obj.insert("from", from_data.version);
+    obj.insert("to", to_data.version);
+    obj.insert("change", change);
+    if(from != -1 && to != -1)
+    {
+        obj.insert("fields",
+                   QJsonArray::fromStringList(change_fields(fields)));
+        obj.insert("old", intrinsic_json(from_data.intrinsics[from], symbols));
+    }
+
+    out << QJsonDocument(obj).toJson(QJsonDocument::Compact) << '\n';
+}
+} // namespace
+
+bool
+option_given(int argc, char* argv[], const char* option)
+{
+    for(int n = 1; n < argc; ++n)
+        if(std::strcmp(argv[n], option) == 0) return true;
+
+    return false;
+}
+
+QString
+option_value(int argc, char* argv[], const char* option)
+{
+    const std::size_t length = std::strlen(option);
+
+    for(int n = 1; n < argc; ++n)
+        if(std::strncmp(argv[n], option, length) == 0)
+        {
+            if(argv[n][length] == '=')
+                return QString::fromLocal8Bit(argv[n] + length + 1);
+            if(argv[n][length] == '\0' && n + 1 < argc)
+                return QString::fromLocal8Bit(argv[n + 1]);
+        }
+
+    return {};
+}
+
+int
+run_query(const QStringList& arguments,
+          const QString&      data_path,
+          const ParseOptions& options)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Prints the intrinsics matching a query.");
+    parser.addHelpOption();
+
+    const QCommandLineOption query_opt("query", "Run a query without GUI.");
+    const QCommandLineOption batch_opt(
+        "batch", "Read queries from stdin, one per line.");
+    const QCommandLineOption data_opt("data", "Intrinsics data file.", "file");
+    const QCommandLineOption format_opt(
+        "format", "Output format, tsv or json.", "format", "tsv");
+    const QCommandLineOption search_opt(
+        "search", "Search, as typed in the search field.", "text");
+    const QCommandLineOption ret_opt("ret", "Return type.", "type", "*");
+    const QCommandLineOption tech_opt(
+        "tech", "Technology, repeatable.", "tech");
+    const QCommandLineOption cpuid_opt(
+        "cpuid", "CPUID flag, repeatable.", "flag");
+    const QCommandLineOption cat_opt(
+        "category", "Category, repeatable.", "category");
+    const QCommandLineOption trace_opt(
+        "trace", "Write a Chrome trace of the run.", "file");
+    parser.addOptions({query_opt,
+                       batch_opt,
+                       trace_opt,
+                       data_opt,
+                       format_opt,
+                       search_opt,
+                       ret_opt,
+                       tech_opt,
+                       cpuid_opt,
+                       cat_opt});
+    parser.process(arguments);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    Format format = Format::TSV;
+    if(!parse_format(parser.value(format_opt), err, format)) return 1;
+
+    QFile data_file(parser.isSet(data_opt) ? parser.value(data_opt) :
+                                             data_path);
+
+    ParseData data;
+    if(!load_data(&data_file, options, err, data)) return 1;
+
+    const FilterIndex index(data.intrinsics, data.symbols);
+
+    if(!parser.isSet(batch_opt))
+    {
+        const QStringList techs  = parser.values(tech_opt);
+        const QStringList cpuids = parser.values(cpuid_opt);
+        const QStringList cats   = parser.values(cat_opt);
+
+        Query query      = parse_query(parser.value(search_opt));
+        query.ret        = parser.value(ret_opt);
+        query.techs      = QSet<QString>(techs.cbegin(), techs.cend());
+        query.cpuids     = QSet<QString>(cpuids.cbegin(), cpuids.cend());
+        query.categories = QSet<QString>(cats.cbegin(), cats.cend());
+
+        print_matches(out, format, index.ranked(query), data, -1);
+        return 0;
+    }
+
+    // answers are flushed per query, so a caller may wait for them
+    // before writing the next one; TSV answers end with an empty line
+    QTextStream in(stdin);
+    QString     line;
+    for(int number = 0; in.readLineInto(&line); ++number)
+    {
+        print_matches(
+            out, format, index.ranked(parse_query(line)), data, number);
+        if(format == Format::TSV) out << '\n';
+        out.flush();
+    }
+
+    return 0;
+}
+
+int
+run_disasm(const QStringList& arguments,
+           const QString&      data_path,
+           const ParseOptions& options)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Maps the instructions of a disassembly listing to intrinsics.");
+    parser.addHelpOption();
+    parser.addPositionalArgument(
+        "listing", "objdump -d or perf annotate output, stdin if omitted.");
+
+    const QCommandLineOption disasm_opt("disasm", "Read a listing.");
+    const QCommandLineOption data_opt("data", "Intrinsics data file.", "file");
+    const QCommandLineOption format_opt(
+        "format", "Output format, tsv or json.", "format", "tsv");
+    const QCommandLineOption trace_opt(
+        "trace", "Write a Chrome trace of the run.", "file");
+    parser.addOptions({disasm_opt, trace_opt, data_opt, format_opt});
+    parser.process(arguments);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    Format format = Format::TSV;
+    if(!parse_format(parser.value(format_opt), err, format)) return 1;
+
+    QFile data_file(parser.isSet(data_opt) ? parser.value(data_opt) :
+                                             data_path);
+
+    ParseData data;
+    if(!load_data(&data_file, options, err, data)) return 1;
+
+    const QStringList positional = parser.positionalArguments();
+
+    QFile listing;
+    if(positional.isEmpty())
+        listing.open(stdin, QIODevice::ReadOnly);
+    else
+    {
+        listing.setFileName(positional.first());
+        if(!listing.open(QIODevice::ReadOnly))
+        {
+            err << "Failed to open " << listing.fileName() << '\n';
+            return 1;
+        }
+    }
+
+    const InstructionIndex index(data.intrinsics);
+    DisasmReport           report(index, data.intrinsics);
+    {
+        TRACE_SCOPE("disasm");
+
+        QTextStream in(&listing);
+        QString     line;
+        while(in.readLineInto(&line)) report.addLine(line);
+    }
+
+    print_report(out, format, report, data);
+
+    return 0;
+}
+
+int
+run_diff(const QStringList& arguments, const ParseOptions& options)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Prints the intrinsics added, removed and changed between versions "
+        "of the data.");
+    parser.addHelpOption();
+    parser.addPositionalArgument(
+        "files", "Data files, from the oldest to the newest.", "old new...");
+
+    const QCommandLineOption diff_opt("diff", "Compare data files.");
+    const QCommandLineOption format_opt(
+        "format", "Output format, tsv or json.", "format", "tsv");
+    const QCommandLineOption trace_opt(
+        "trace", "Write a Chrome trace of the run.", "file");
+    parser.addOptions({diff_opt, trace_opt, format_opt});
+    parser.process(arguments);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    Format format = Format::TSV;
+    if(!parse_format(parser.value(format_opt), err, format)) return 1;
+
+    const QStringList paths = parser.positionalArguments();
+    if(paths.count() < 2)
+    {
+        err << "At least two data files are needed.\n";
+        return 1;
+    }
+
+    QVector<ParseData> versions(paths.count());
+    for(int v = 0; v < paths.count(); ++v)
+    {
+        QFile data_file(paths[v]);
+        if(!load_data(&data_file, options, err, versions[v])) return 1;
+
+        // versions are told by the file names if the data doesn't
+        if(versions[v].version.isEmpty())
+            versions[v].version = QFileInfo(paths[v]).fileName();
+    }
+
+    try
+    {
+        share_symbols(versions);
+    }
+    catch(const ParsingError& ex)
+    {
+        err << "Failed to merge the data: " << error_text(ex) << '\n';
+        return 1;
+    }
+
+    for(int v = 1; v < versions.count(); ++v)
+    {
+        const ParseData&     from = versions[v - 1];
+        const ParseData&     to   = versions[v];
+        const IntrinsicsDiff diff =
+            diff_intrinsics(from.intrinsics, to.intrinsics);
+
+        for(const int n: diff.removed)
+            print_change(out, format, "removed", from, n, to, -1, 0);
+        for(const int n: diff.added)
+            print_change(out, format, "added", from, -1, to, n, 0);
+        for(const IntrinsicChange& c: diff.changed)
+            print_change(
+                out, format, "changed", from, c.from, to, c.to, c.fields);
+    }
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+// -*- C++ -*-
+// cli.hpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "index.hpp"
+#include "parser.hpp"
+
+#include <QString>
+#include <QStringList>
+
+// Command line query mode. It loads the data once and prints the matches
+// of the query given in the options, or of every query read from stdin in
+// batch mode, as TSV or as JSON lines.
+
+// whether the option is among the arguments, before QCoreApplication
+// parses them, to tell the modes without a window from the GUI
+bool
+option_given(int argc, char* argv[], const char* option);
+
+// value of the option given as "--option value" or "--option=value"
+QString
+option_value(int argc, char* argv[], const char* option);
+
+int
+run_query(const QStringList& arguments,
+          const QString&      data_path,
+          const ParseOptions& options);
+
+// Disassembly mode. It maps the instructions of an objdump -d or perf
+// annotate listing to their intrinsics and prints the counts of every
+// instruction with the CPUIDs it needs, and the CPUIDs of the whole.
+int
+run_disasm(const QStringList& arguments,
+           const QString&      data_path,
+           const ParseOptions& options);
+
+// Diff mode. It loads the data files given, from the oldest to the newest,
+// with shared symbols and prints the intrinsics removed, added and changed
+// between every two consecutive ones.
+int
+run_diff(const QStringList& arguments, const ParseOptions& options);
@@ -19,40 +19,13 @@
 #include "details.hpp"
 
 #include <QHBoxLayout>
-#include <QRegularExpression>
 #include <QString>
-#include <QStringList>
 #include <QVBoxLayout>
 #include <QVector>
 #include <QWidget>
 
-QString
-html_parms(const QVector<Var>& parms) noexcept
-{
-    QStringList varlist;
-
-    static const QString type_html = "<font color=darkBlue>%1</font>";
-    static const QString parm_html = "<font color=darkCyan>%1</font>";
-
-    for(const Var& var: parms)
-        varlist.append(type_html.arg(var.type) + ' ' + parm_html.arg(var.name));
-
-    static const QString comma(", ");
-    return varlist.join(comma);
-}
-
-QString
-format_instructions(const QVector<Instruction>& ins) noexcept
-{
-    QStringList list;
-
-    for(const Instruction& i: ins)
-        list.append(QString("%1 %2").arg(i.name.toLower(), i.form));
-
-    return list.join('\n');
-}
-
-IntrinsicDetails::IntrinsicDetails(const Intrinsic& i, QWidget* parent) :
+IntrinsicDetails::IntrinsicDetails(const RenderedDetails& details,
+                                   QWidget*               parent) :
     QScrollArea(parent)
 {
     setObjectName("idetails");
@@ -124,32 +97,85 @@ IntrinsicDetails::IntrinsicDetails(const Intrinsic& i, QWidget* parent) :
     setWidget(widget);
     setWidgetResizable(true);
 
-    setIntrinsic(i);
+    setDetails(details);
+}
+
+void
+IntrinsicDetails::setDetails(const RenderedDetails& d)
+{
+    p_signature->setText(d.signature);
+    p_header->setText(d.header);
+
+    p_instructions_label->setHidden(d.instructions.isEmpty());
+    p_instructions->setHidden(d.instructions.isEmpty());
+    if(!d.instructions.isEmpty()) p_instructions->setText(d.instructions);
+
+    p_cpuids->setText(d.cpuids);
+
+    p_description->setText(d.description);
+
+    p_operation_label->setHidden(d.operation.isEmpty());
+    p_operation->setHidden(d.operation.isEmpty());
+    if(!d.operation.isEmpty()) p_operation->setText(d.operation);
+}
+
+DetailsCache::DetailsCache(QObject* parent) : QObject(parent)
+{
+    // zero interval timers fire once the event queue is empty
+    p_idle->setInterval(0);
+    QObject::connect(
+        p_idle, &QTimer::timeout, this, &DetailsCache::renderQueued);
+}
+
+void
+DetailsCache::setIntrinsics(const Intrinsics&              intrinsics,
+                            std::shared_ptr<const Symbols> symbols)
+{
+    m_intrinsics = intrinsics;
+    p_symbols    = std::move(symbols);
+    m_cache.clear();
+    m_queue.clear();
+    p_idle->stop();
 }
 
 void
-IntrinsicDetails::setIntrinsic(const Intrinsic& i)
+DetailsCache::prefetch(const QVector<int>& positions)
 {
-    static const QString sign_html("<font color=darkBlue>%1</font> %2(%3)");
-    p_signature->setText(
-        sign_html.arg(i.ret_type, i.name, html_parms(i.parms)));
+    m_queue.clear();
+    m_queue.reserve(positions.count());
 
-    static const QString inc_template("#include <%1>");
-    p_header->setText(inc_template.arg(i.header));
+    // the queue is popped from the back
+    for(auto it = positions.crbegin(); it != positions.crend(); ++it)
+        if(!m_cache.contains(*it)) m_queue.append(*it);
+
+    if(!m_queue.isEmpty()) p_idle->start();
+}
 
-    p_instructions_label->setHidden(i.instructions.empty());
-    p_instructions->setHidden(i.instructions.empty());
-    if(!i.instructions.empty())
-        p_instructions->setText(format_instructions(i.instructions));
+void
+DetailsCache::renderQueued()
+{
+    for(int n = 0; n < batch && !m_queue.isEmpty(); ++n)
+    {
+        const int position = m_queue.takeLast();
+        if(!m_cache.contains(position))
+            m_cache.insert(position,
+                           new RenderedDetails(render_details(
+                               m_intrinsics[position], *p_symbols)));
+    }
+
+    if(m_queue.isEmpty()) p_idle->stop();
+}
 
-    p_cpuids->setText(QStringList(i.cpuids.values()).join(" + "));
+RenderedDetails
+DetailsCache::details(const int position)
+{
+    if(const RenderedDetails* cached = m_cache.object(position))
+        return *cached;
 
-    static const QRegularExpression re_var("\"(\\w+)\"");
-    QString                         descr = i.description;
-    p_description->setText(
-        descr.replace(re_var, "<font color=darkCyan>\\1</font>"));
+    RenderedDetails* rendered =
+        new RenderedDetails(render_details(m_intrinsics[position], *p_symbols));
+    const RenderedDetails ret = *rendered;
+    m_cache.insert(position, rendered);
 
-    p_operation_label->setHidden(i.operation.isEmpty());
-    p_operation->setHidden(i.operation.isEmpty());
-    if(!i.operation.isEmpty()) p_operation->setText(i.operation);
+    return ret;
 }
@@ -19,10 +19,18 @@
 #pragma once
 
 #include "parser.hpp"
+#include "render.hpp"
 
+#include <QCache>
 #include <QFont>
 #include <QLabel>
+#include <QObject>
 #include <QScrollArea>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+#include <memory>
 
 class IntrinsicDetails : public QScrollArea
 {
@@ -41,8 +49,45 @@ class IntrinsicDetails : public QScrollArea
     QLabel* p_operation          = new QLabel;
 
     void
-    setIntrinsic(const Intrinsic&);
+    setDetails(const RenderedDetails&);
+
+  public:
+    IntrinsicDetails(const RenderedDetails& details,
+                     QWidget*               parent = nullptr);
+};
+
+// Rendered details by intrinsic position. Positions asked to be prefetched
+// are rendered a few at a time while the event loop is idle.
+class DetailsCache : public QObject
+{
+    Q_OBJECT
+
+    // rendered details kept at most
+    static constexpr int capacity = 2048;
+    // renderings per idle pass
+    static constexpr int batch = 4;
+
+    Intrinsics                     m_intrinsics;
+    std::shared_ptr<const Symbols> p_symbols = std::make_shared<Symbols>();
+    QCache<int, RenderedDetails>   m_cache{capacity};
+    QVector<int>                   m_queue;
+    QTimer*                        p_idle = new QTimer(this);
+
+  private slots:
+    void
+    renderQueued();
 
   public:
-    IntrinsicDetails(const Intrinsic& i, QWidget* parent = nullptr);
+    explicit DetailsCache(QObject* parent = nullptr);
+
+    void
+    setIntrinsics(const Intrinsics&              intrinsics,
+                  std::shared_ptr<const Symbols> symbols);
+
+    // Replaces the prefetch queue, the first positions are rendered first
+    void
+    prefetch(const QVector<int>& positions);
+
+    RenderedDetails
+    details(const int position);
 };
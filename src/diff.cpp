@@ -0,0 +1,246 @@
+// -*- C++ -*-
+// diff.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "diff.hpp"
+#include "trace.hpp"
+
+#include <QFuture>
+#include <QHash>
+#include <QSet>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+
+namespace
+{
+// what intrinsicID tells, without formatting it
+struct Identity
+{
+    QString   name;
+    SymbolID  tech;
+    CpuidMask cpuids;
+
+    bool
+    operator==(const Identity& other) const noexcept
+    {
+        return tech == other.tech && cpuids == other.cpuids &&
+               name == other.name;
+    }
+};
+
+uint
+qHash(const Identity& id, const uint seed = 0) noexcept
+{
+    return ::qHash(id.name, seed) ^ (uint(id.tech) << 16) ^
+           uint(std::hash<CpuidMask>()(id.cpuids));
+}
+
+Identity
+identity(const Intrinsic& i)
+{
+    return {i.name, i.tech, i.cpuids};
+}
+
+bool
+same_parms(const QVector<Var>& lhs, const QVector<Var>& rhs) noexcept
+{
+    return std::equal(lhs.cbegin(),
+                      lhs.cend(),
+                      rhs.cbegin(),
+                      rhs.cend(),
+                      [](const Var& l, const Var& r)
+                      { return l.name == r.name && l.type == r.type; });
+}
+
+bool
+same_instructions(const QVector<Instruction>& lhs,
+                  const QVector<Instruction>& rhs) noexcept
+{
+    return std::equal(lhs.cbegin(),
+                      lhs.cend(),
+                      rhs.cbegin(),
+                      rhs.cend(),
+                      [](const Instruction& l, const Instruction& r)
+                      {
+                          return l.name == r.name && l.form == r.form &&
+                                 l.xed == r.xed;
+                      });
+}
+
+int
+changed_fields(const Intrinsic& from, const Intrinsic& to)
+{
+    int ret = 0;
+    if(from.tech != to.tech) ret |= IntrinsicChange::TECH;
+    if(from.cpuids != to.cpuids) ret |= IntrinsicChange::CPUIDS;
+    if(from.category != to.category) ret |= IntrinsicChange::CATEGORY;
+    if(from.ret_type != to.ret_type) ret |= IntrinsicChange::RET;
+    if(from.header != to.header) ret |= IntrinsicChange::HEADER;
+    if(!same_parms(from.parms, to.parms)) ret |= IntrinsicChange::PARMS;
+    if(!same_instructions(from.instructions, to.instructions))
+        ret |= IntrinsicChange::INSTRUCTIONS;
+
+    // the texts are decoded only now
+    if(from.description.toString() != to.description.toString())
+        ret |= IntrinsicChange::DESCRIPTION;
+    if(from.operation.toString() != to.operation.toString())
+        ret |= IntrinsicChange::OPERATION;
+
+    return ret;
+}
+} // namespace
+
+void
+share_symbols(QVector<ParseData>& versions)
+{
+    TRACE_SCOPE("share_symbols");
+
+    if(versions.isEmpty()) return;
+
+    auto symbols = std::make_shared<Symbols>(*versions.front().symbols);
+
+    QSet<QString> names;
+    for(int v = 0; v < versions.count(); ++v)
+    {
+        ParseData& data = versions[v];
+
+        Symbols::Remap remap;
+        if(v) remap = symbols->merge(*data.symbols);
+        if(symbols->cpuids.count() > max_cpuids)
+            throw ParsingError{ParsingError::TOO_MANY_CPUIDS};
+
+        for(Intrinsic& i: data.intrinsics)
+        {
+            if(v) remap_intrinsic(i, remap);
+            i.name = *names.insert(i.name);
+        }
+    }
+
+    for(ParseData& data: versions) data.symbols = symbols;
+}
+
+QStringList
+change_fields(const int fields)
+{
+    static const char* const names[] = {"tech",
+                                        "cpuids",
+                                        "category",
+                                        "return",
+                                        "parameters",
+                                        "header",
+                                        "instructions",
+                                        "description",
+                                        "operation"};
+
+    QStringList ret;
+    for(int n = 0; n < int(std::size(names)); ++n)
+        if(fields & (1 << n)) ret.append(names[n]);
+
+    return ret;
+}
+
+IntrinsicsDiff
+diff_intrinsics(const Intrinsics& from, const Intrinsics& to)
+{
+    TRACE_SCOPE("diff_intrinsics");
+
+    // positions of the old intrinsics by identity, duplicates pair in order
+    QHash<Identity, QVector<int>> old_ids;
+    old_ids.reserve(from.count());
+    for(int n = 0; n < from.count(); ++n)
+        old_ids[identity(from[n])].append(n);
+
+    QVector<IntrinsicChange> pairs;
+    QVector<bool>            paired(from.count(), false);
+    QVector<int>             unpaired;
+    pairs.reserve(to.count());
+
+    for(int n = 0; n < to.count(); ++n)
+    {
+        const auto found = old_ids.find(identity(to[n]));
+        if(found == old_ids.end() || found->isEmpty())
+        {
+            unpaired.append(n);
+            continue;
+        }
+
+        const int old = found->takeFirst();
+        paired[old]   = true;
+        pairs.append({old, n, 0});
+    }
+
+    // the rest by name, of the same tech first
+    QHash<QString, QVector<int>> old_names;
+    for(int n = 0; n < from.count(); ++n)
+        if(!paired[n]) old_names[from[n].name].append(n);
+
+    IntrinsicsDiff ret;
+    for(const int n: unpaired)
+    {
+        const auto found = old_names.find(to[n].name);
+        if(found == old_names.end() || found->isEmpty())
+        {
+            ret.added.append(n);
+            continue;
+        }
+
+        const auto same_tech =
+            std::find_if(found->cbegin(),
+                         found->cend(),
+                         [&](const int old)
+                         { return from[old].tech == to[n].tech; });
+        const int old = same_tech != found->cend() ? *same_tech :
+                                                     found->front();
+        found->removeOne(old);
+        paired[old] = true;
+        pairs.append({old, n, 0});
+    }
+
+    for(int n = 0; n < from.count(); ++n)
+        if(!paired[n]) ret.removed.append(n);
+
+    // comparing the texts decodes them, a chunk of pairs per thread
+    IntrinsicChange* changes = pairs.data();
+    const int        chunk =
+        qMax(1, pairs.count() / qMax(1, QThread::idealThreadCount()) + 1);
+
+    QVector<QFuture<void>> futures;
+    for(int begin = 0; begin < pairs.count(); begin += chunk)
+        futures.append(QtConcurrent::run(
+            [&, begin, end = qMin(begin + chunk, pairs.count())]()
+            {
+                for(int p = begin; p < end; ++p)
+                    changes[p].fields = changed_fields(from[changes[p].from],
+                                                       to[changes[p].to]);
+            }));
+    for(QFuture<void>& future: futures) future.waitForFinished();
+
+    for(const IntrinsicChange& change: pairs)
+        if(change.fields) ret.changed.append(change);
+
+    std::sort(ret.changed.begin(),
+              ret.changed.end(),
+              [](const IntrinsicChange& lhs, const IntrinsicChange& rhs)
+              { return lhs.to < rhs.to; });
+
+    return ret;
+}
@@ -0,0 +1,78 @@
+// -*- C++ -*-
+// diff.hpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "parser.hpp"
+
+#include <QStringList>
+#include <QVector>
+
+// Puts the symbols of the versions into one table shared by all of them.
+// The first version keeps its IDs, the intrinsics of the others are
+// remapped, and names equal across versions share their strings. Throws
+// ParsingError if the CPUIDs of all versions don't fit a mask.
+void
+share_symbols(QVector<ParseData>& versions);
+
+struct IntrinsicChange
+{
+    enum Field
+    {
+        TECH         = 1 << 0,
+        CPUIDS       = 1 << 1,
+        CATEGORY     = 1 << 2,
+        RET          = 1 << 3,
+        PARMS        = 1 << 4,
+        HEADER       = 1 << 5,
+        INSTRUCTIONS = 1 << 6,
+        DESCRIPTION  = 1 << 7,
+        OPERATION    = 1 << 8
+    };
+
+    int from   = -1;
+    int to     = -1;
+    int fields = 0;
+};
+
+// names of the fields of a change
+QStringList
+change_fields(const int fields);
+
+// Positions of the added intrinsics in the new version and of the removed
+// ones in the old version, and the pairs of changed ones, all in the order
+// of the versions.
+struct IntrinsicsDiff
+{
+    QVector<int>             added;
+    QVector<int>             removed;
+    QVector<IntrinsicChange> changed;
+
+    bool
+    isEmpty() const noexcept
+    {
+        return added.isEmpty() && removed.isEmpty() && changed.isEmpty();
+    }
+};
+
+// Changes between two versions sharing symbols. Intrinsics are paired by
+// the identity of intrinsicID, name, tech and CPUIDs, through a hash of
+// it. The rest are paired by name, which tells moves between techs and
+// CPUID reclassifications from additions and removals.
+IntrinsicsDiff
+diff_intrinsics(const Intrinsics& from, const Intrinsics& to);
@@ -0,0 +1,462 @@
+// -*- C++ -*-
+// disasm.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "disasm.hpp"
+
+#include <QSet>
+#include <QStringList>
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+// instruction prefixes objdump prints as separate words
+const QSet<QString> prefixes{"lock",
+                             "rep",
+                             "repz",
+                             "repe",
+                             "repnz",
+                             "repne",
+                             "notrack",
+                             "bnd",
+                             "data16",
+                             "addr32",
+                             "{vex}",
+                             "{vex3}",
+                             "{evex}"};
+
+// general purpose registers by their class, r8 to r15 aside
+const QHash<QString, QString> gprs{
+    {"rax", "r64"}, {"rbx", "r64"}, {"rcx", "r64"}, {"rdx", "r64"},
+    {"rsi", "r64"}, {"rdi", "r64"}, {"rbp", "r64"}, {"rsp", "r64"},
+    {"eax", "r32"}, {"ebx", "r32"}, {"ecx", "r32"}, {"edx", "r32"},
+    {"esi", "r32"}, {"edi", "r32"}, {"ebp", "r32"}, {"esp", "r32"},
+    {"ax", "r16"},  {"bx", "r16"},  {"cx", "r16"},  {"dx", "r16"},
+    {"si", "r16"},  {"di", "r16"},  {"bp", "r16"},  {"sp", "r16"},
+    {"al", "r8"},   {"bl", "r8"},   {"cl", "r8"},   {"dl", "r8"},
+    {"ah", "r8"},   {"bh", "r8"},   {"ch", "r8"},   {"dh", "r8"},
+    {"sil", "r8"},  {"dil", "r8"},  {"bpl", "r8"},  {"spl", "r8"}};
+
+bool
+is_hex(QStringView s) noexcept
+{
+    for(const QChar c: s)
+        if(!c.isDigit() && !(c >= 'a' && c <= 'f') && !(c >= 'A' && c <= 'F'))
+            return false;
+    return !s.isEmpty();
+}
+
+// Words before the instruction: addresses, code bytes, perf percentages
+// and prefixes. Long hex numbers are the addresses of label lines.
+bool
+is_skipped(QStringView word)
+{
+    if(word.endsWith(':')) return is_hex(word.chopped(1));
+    if(is_hex(word)) return word.size() == 2 || word.size() >= 8;
+    if(word.front().isDigit()) return true;
+
+    return word.size() <= 7 && prefixes.contains(word.toString());
+}
+
+// Mnemonics are printed in one case, XED iforms mix them with '_'.
+bool
+is_mnemonic(QStringView word) noexcept
+{
+    if(!word.front().isLetter()) return false;
+
+    bool lower = false;
+    bool upper = false;
+    bool under = false;
+    for(const QChar c: word)
+    {
+        if(c == '_')
+            under = true;
+        else if(c.isLower())
+            lower = true;
+        else if(c.isUpper())
+            upper = true;
+        else if(!c.isDigit() && c != '.')
+            return false;
+    }
+
+    return under || !(lower && upper);
+}
+
+// the instruction with its operands, without the rest of the line
+QStringView
+instruction_text(QStringView line)
+{
+    // perf annotate puts the percentages before a bar
+    const int bar = int(std::max(line.lastIndexOf(QChar(0x2502)),
+                                 line.lastIndexOf(QChar('|'))));
+    if(bar != -1) line = line.mid(bar + 1);
+
+    int pos = 0;
+    while(pos < line.size())
+    {
+        while(pos < line.size() && line[pos].isSpace()) ++pos;
+
+        int end = pos;
+        while(end < line.size() && !line[end].isSpace()) ++end;
+        if(end == pos) break;
+
+        const QStringView word = line.mid(pos, end - pos);
+        if(!is_skipped(word))
+        {
+            if(!is_mnemonic(word)) break;
+
+            // objdump comments and symbols of jump targets
+            QStringView text = line.mid(pos);
+            for(const QChar c: {QChar('#'), QChar('<')})
+            {
+                const int cut = int(text.indexOf(c));
+                if(cut != -1) text = text.left(cut);
+            }
+            return text.trimmed();
+        }
+
+        pos = end;
+    }
+
+    return {};
+}
+
+// operands split at the commas outside of parentheses and braces
+QVector<QStringView>
+operands(QStringView text)
+{
+    QVector<QStringView> ret;
+
+    int depth = 0;
+    int start = 0;
+    for(int n = 0; n < text.size(); ++n)
+    {
+        const QChar c = text[n];
+        if(c == '(' || c == '[' || c == '{')
+            ++depth;
+        else if(c == ')' || c == ']' || c == '}')
+            --depth;
+        else if(c == ',' && depth == 0)
+        {
+            ret.append(text.mid(start, n - start).trimmed());
+            start = n + 1;
+        }
+    }
+
+    const QStringView last = text.mid(start).trimmed();
+    if(!last.isEmpty() || !ret.isEmpty()) ret.append(last);
+
+    return ret;
+}
+
+enum class Masking
+{
+    NONE,
+    MERGE,
+    ZERO
+};
+
+// the operand without decorations in braces and the masking they tell
+QStringView
+undecorated(QStringView operand, Masking& masking)
+{
+    masking = Masking::NONE;
+
+    const int brace = int(operand.indexOf('{'));
+    if(brace == -1) return operand;
+
+    for(int n = brace; n != -1; n = int(operand.indexOf('{', n + 1)))
+    {
+        QStringView inner = operand.mid(n + 1);
+        if(inner.startsWith('%')) inner = inner.mid(1);
+        if(inner.size() < 2) continue;
+
+        // {z} zeroes whatever mask goes with it
+        if(inner.startsWith('z', Qt::CaseInsensitive) && inner[1] == '}')
+            masking = Masking::ZERO;
+        // k1 to k7 in listings, a bare k in the data
+        else if(inner.startsWith('k', Qt::CaseInsensitive) &&
+                (inner[1].isDigit() || inner[1] == '}') &&
+                masking == Masking::NONE)
+            masking = Masking::MERGE;
+    }
+
+    return operand.left(brace).trimmed();
+}
+
+QString
+masked_class(const QString& cls, const Masking masking)
+{
+    switch(masking)
+    {
+    case Masking::NONE:
+        return cls;
+    case Masking::MERGE:
+        return cls + " {k}";
+    case Masking::ZERO:
+        return cls + " {z}";
+    }
+
+    return cls;
+}
+
+// class of a register or of an operand of a listing
+QString
+listing_class(QStringView operand)
+{
+    Masking     masking = Masking::NONE;
+    QStringView base    = undecorated(operand, masking);
+
+    QString ret;
+    if(base.contains('(') || base.contains('[') ||
+       base.contains(QLatin1String("ptr"), Qt::CaseInsensitive))
+        ret = "m";
+    else if(base.startsWith('$') || base.startsWith('-') ||
+            (!base.isEmpty() && base.front().isDigit()))
+        ret = "imm";
+    else
+    {
+        if(base.startsWith('%')) base = base.mid(1);
+        QString name = base.toString().toLower();
+
+        // the register number goes
+        int digits = name.size();
+        while(digits > 0 && name[digits - 1].isDigit()) --digits;
+
+        const QString stem = name.left(digits);
+        if(stem == "xmm" || stem == "ymm" || stem == "zmm" || stem == "k" ||
+           stem == "mm")
+            ret = stem;
+        else if(name.startsWith('r') && name.size() > 1 && name[1].isDigit())
+        {
+            // r8 to r15 and their d, w and b or l parts
+            const QChar part = name.back();
+            ret = part == 'd' ? "r32" :
+                  part == 'w' ? "r16" :
+                  part == 'b' || part == 'l' ? "r8" :
+                                "r64";
+        }
+        else
+            ret = gprs.value(name, name);
+    }
+
+    return masked_class(ret, masking);
+}
+
+// class of an operand of a form of the data
+QString
+data_class(QStringView operand)
+{
+    Masking       masking = Masking::NONE;
+    const QString base =
+        undecorated(operand, masking).toString().toLower();
+
+    QString ret = base;
+    if(base.startsWith("imm"))
+        ret = "imm";
+    else if(base.startsWith("vm") ||
+            (base.startsWith('m') && base.size() > 1 && base[1].isDigit()) ||
+            base == "m" || base == "mem")
+        ret = "m";
+
+    return masked_class(ret, masking);
+}
+
+DisasmInstruction
+classify(QStringView text)
+{
+    DisasmInstruction ret;
+    if(text.isEmpty()) return ret;
+
+    int space = 0;
+    while(space < text.size() && !text[space].isSpace()) ++space;
+
+    ret.mnemonic = text.left(space).toString().toLower();
+
+    QVector<QStringView> parts = operands(text.mid(space));
+
+    // AT&T syntax lists the destination last
+    if(text.contains('%') || text.contains('$'))
+        std::reverse(parts.begin(), parts.end());
+
+    QStringList classes;
+    for(const QStringView part: parts) classes.append(listing_class(part));
+    ret.form = classes.join(", ");
+
+    return ret;
+}
+
+// CPUIDs the intrinsics of a line share. A mnemonic with forms in several
+// extensions, vpaddd in AVX, AVX2 and AVX-512, shares none, then those of
+// the least demanding intrinsic stand for the line.
+CpuidMask
+line_cpuids(const QVector<int>& matches, const Intrinsics& intrinsics)
+{
+    CpuidMask   common;
+    CpuidMask   least;
+    std::size_t least_count = 0;
+
+    if(!matches.isEmpty()) common.set();
+    for(const int n: matches)
+    {
+        const CpuidMask& cpuids = intrinsics[n].cpuids;
+        common &= cpuids;
+
+        const std::size_t count = cpuids.count();
+        if(count != 0 && (least_count == 0 || count < least_count))
+        {
+            least       = cpuids;
+            least_count = count;
+        }
+    }
+
+    return common.any() ? common : least;
+}
+
+void
+append_once(QVector<int>& positions, const int n)
+{
+    if(positions.isEmpty() || positions.last() != n) positions.append(n);
+}
+} // namespace
+
+DisasmInstruction
+parse_disasm_line(QStringView line)
+{
+    return classify(instruction_text(line));
+}
+
+QString
+form_class(const QString& form)
+{
+    QStringList classes;
+    for(const QStringView part: operands(form))
+        classes.append(data_class(part));
+
+    return classes.join(", ");
+}
+
+InstructionIndex::InstructionIndex(const Intrinsics& intrinsics)
+{
+    for(int n = 0; n < intrinsics.count(); ++n)
+        for(const Instruction& ins: intrinsics[n].instructions)
+        {
+            const QString mnemonic = ins.name.toLower();
+            append_once(m_mnemonics[mnemonic], n);
+            append_once(m_forms[mnemonic + ' ' + form_class(ins.form)], n);
+            if(!ins.xed.isEmpty()) append_once(m_xeds[ins.xed.toLower()], n);
+        }
+}
+
+InstructionIndex::Match
+InstructionIndex::find(const DisasmInstruction& instruction) const
+{
+    QString mnemonic = instruction.mnemonic;
+
+    auto found = m_mnemonics.constFind(mnemonic);
+    if(found == m_mnemonics.cend() && mnemonic.size() > 3 &&
+       QStringLiteral("bwlq").contains(mnemonic.back()))
+    {
+        mnemonic.chop(1);
+        found = m_mnemonics.constFind(mnemonic);
+    }
+
+    if(found == m_mnemonics.cend())
+    {
+        const auto xed = m_xeds.constFind(instruction.mnemonic);
+        return xed != m_xeds.cend() ? Match{*xed, true} : Match{};
+    }
+
+    const auto form = m_forms.constFind(mnemonic + ' ' + instruction.form);
+    return form != m_forms.cend() ? Match{*form, true} : Match{*found, false};
+}
+
+DisasmReport::DisasmReport(const InstructionIndex& index,
+                           const Intrinsics&       intrinsics) :
+    p_index(&index),
+    p_intrinsics(&intrinsics)
+{
+}
+
+void
+DisasmReport::addLine(QStringView line)
+{
+    ++m_lines;
+
+    const QStringView text = instruction_text(line);
+    if(text.isEmpty()) return;
+
+    const QString line_key = text.toString();
+    auto          line_id  = m_line_ids.constFind(line_key);
+    if(line_id != m_line_ids.cend())
+    {
+        ++m_entries[*line_id].count;
+        return;
+    }
+
+    DisasmInstruction instruction = classify(text);
+    const QString     key = instruction.mnemonic + ' ' + instruction.form;
+
+    int id = m_entry_ids.value(key, -1);
+    if(id == -1)
+    {
+        Entry entry;
+        entry.match       = p_index->find(instruction);
+        entry.instruction = std::move(instruction);
+
+        entry.cpuids = line_cpuids(entry.match.intrinsics, *p_intrinsics);
+
+        id = m_entries.count();
+        m_entries.append(std::move(entry));
+        m_entry_ids.insert(key, id);
+    }
+
+    m_line_ids.insert(line_key, id);
+    ++m_entries[id].count;
+}
+
+QVector<DisasmReport::Entry>
+DisasmReport::entries() const
+{
+    QVector<Entry> ret = m_entries;
+    std::stable_sort(ret.begin(),
+                     ret.end(),
+                     [](const Entry& lhs, const Entry& rhs)
+                     { return lhs.count > rhs.count; });
+
+    return ret;
+}
+
+int
+DisasmReport::instructions() const noexcept
+{
+    int ret = 0;
+    for(const Entry& entry: m_entries) ret += entry.count;
+
+    return ret;
+}
+
+CpuidMask
+DisasmReport::cpuids() const noexcept
+{
+    CpuidMask ret;
+    for(const Entry& entry: m_entries) ret |= entry.cpuids;
+
+    return ret;
+}
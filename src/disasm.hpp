@@ -0,0 +1,132 @@
+// -*- C++ -*-
+// disasm.hpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "parser.hpp"
+#include "symbols.hpp"
+
+#include <QHash>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+// Instruction of a disassembly line, the mnemonic in lower case and the
+// operands as classes in the order of the data: "vpaddd" and
+// "ymm, ymm, m". Registers become their class, memory operands "m",
+// immediates "imm", merge-masked operands get " {k}" and zero-masked ones
+// " {z}".
+struct DisasmInstruction
+{
+    QString mnemonic;
+    QString form;
+
+    bool
+    isEmpty() const noexcept
+    {
+        return mnemonic.isEmpty();
+    }
+};
+
+// Instruction of a line of objdump -d or perf annotate output, in AT&T or
+// Intel syntax, empty for lines without one. Addresses, code bytes and
+// prefixes are skipped.
+DisasmInstruction
+parse_disasm_line(QStringView line);
+
+// operand classes of a form of the data, as parse_disasm_line gives them
+QString
+form_class(const QString& form);
+
+// Intrinsics by the instructions they compile to: by mnemonic, by mnemonic
+// and form and by XED iform, all in lower case.
+class InstructionIndex
+{
+    QHash<QString, QVector<int>> m_mnemonics;
+    QHash<QString, QVector<int>> m_forms;
+    QHash<QString, QVector<int>> m_xeds;
+
+  public:
+    InstructionIndex() = default;
+
+    explicit InstructionIndex(const Intrinsics& intrinsics);
+
+    struct Match
+    {
+        QVector<int> intrinsics;
+        // the form matched as well, not only the mnemonic
+        bool exact = false;
+    };
+
+    // Intrinsics of the instruction. A mnemonic of AT&T syntax may carry an
+    // operand size suffix, which is dropped when the mnemonic is unknown.
+    // XED iforms are looked up as mnemonics.
+    Match
+    find(const DisasmInstruction& instruction) const;
+};
+
+// Counts of the instructions of a listing with their intrinsics and the
+// CPUIDs they need, those the intrinsics of an instruction share or else
+// those of the least demanding of them. Lines with the same instruction
+// text are parsed and looked up once.
+class DisasmReport
+{
+  public:
+    struct Entry
+    {
+        DisasmInstruction       instruction;
+        InstructionIndex::Match match;
+        CpuidMask               cpuids; // the least its intrinsics need
+        int                     count = 0;
+    };
+
+  private:
+    const InstructionIndex* p_index;
+    const Intrinsics*       p_intrinsics;
+    QVector<Entry>          m_entries;
+
+    // entries by mnemonic and form and by the text of the lines
+    QHash<QString, int> m_entry_ids;
+    QHash<QString, int> m_line_ids;
+    int                 m_lines = 0;
+
+  public:
+    // both must outlive the report
+    DisasmReport(const InstructionIndex& index, const Intrinsics& intrinsics);
+
+    void
+    addLine(QStringView line);
+
+    // entries by count, the most frequent first
+    QVector<Entry>
+    entries() const;
+
+    int
+    lines() const noexcept
+    {
+        return m_lines;
+    }
+
+    // number of the instructions found in the lines
+    int
+    instructions() const noexcept;
+
+    // CPUIDs the matched instructions need together
+    CpuidMask
+    cpuids() const noexcept;
+};
@@ -0,0 +1,317 @@
+// -*- C++ -*-
+// fuzzy.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "fuzzy.hpp"
+
+#include <QVarLengthArray>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+// bytes past the texts, so 16 byte loads never leave the buffer
+constexpr int padding = 16;
+
+constexpr char separator = '\n';
+
+// per matched letter
+constexpr int score_match       = 16;
+constexpr int bonus_boundary    = 8;
+constexpr int bonus_transition  = 4;
+constexpr int bonus_consecutive = 6;
+constexpr int penalty_gap_start = 3;
+constexpr int penalty_gap       = 1;
+
+// names win over mnemonics matching as well
+constexpr int penalty_mnemonic = 8;
+
+char
+fold_char(const QChar c) noexcept
+{
+    const ushort u = c.unicode();
+    if(u >= 'A' && u <= 'Z') return static_cast<char>(u - 'A' + 'a');
+    if(u < 128) return static_cast<char>(u);
+    return '?';
+}
+
+quint64
+class_bit(const char c) noexcept
+{
+    if(c >= 'a' && c <= 'z') return quint64(1) << (c - 'a');
+    if(c >= '0' && c <= '9') return quint64(1) << (26 + c - '0');
+    if(c == '_') return quint64(1) << 36;
+    return quint64(1) << (37 + (c & 15));
+}
+
+quint64
+class_mask(const char* begin, const char* end) noexcept
+{
+    quint64 ret = 0;
+    for(const char* p = begin; p != end; ++p)
+        if(*p != separator) ret |= class_bit(*p);
+    return ret;
+}
+
+// first c in [p, end), end if none
+const char*
+find_byte(const char* p, const char* end, const char c) noexcept
+{
+#if defined(__SSE2__)
+    const __m128i needle = _mm_set1_epi8(c);
+    for(; p < end; p += 16)
+    {
+        const __m128i block =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const int hits = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+        if(hits)
+            return std::min(p + qCountTrailingZeroBits(quint32(hits)), end);
+    }
+    return end;
+#else
+    const void* hit = std::memchr(p, c, static_cast<std::size_t>(end - p));
+    return hit ? static_cast<const char*>(hit) : end;
+#endif
+}
+
+// bits of the 64 masks having all the needed classes
+quint64
+mask_hits(const quint64* masks, const quint64 need) noexcept
+{
+    quint64 ret = 0;
+
+#if defined(__SSE2__)
+    const __m128i needed = _mm_set1_epi64x(static_cast<qint64>(need));
+    for(int n = 0; n < 64; n += 2)
+    {
+        const __m128i m =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks + n));
+        // 64 bit lanes are equal when both their 32 bit halves are
+        const __m128i eq32 =
+            _mm_cmpeq_epi32(_mm_and_si128(m, needed), needed);
+        const __m128i swapped =
+            _mm_shuffle_epi32(eq32, _MM_SHUFFLE(2, 3, 0, 1));
+        const __m128i eq64 = _mm_and_si128(eq32, swapped);
+        ret |= quint64(_mm_movemask_pd(_mm_castsi128_pd(eq64))) << n;
+    }
+#else
+    for(int n = 0; n < 64; ++n)
+        if((masks[n] & need) == need) ret |= quint64(1) << n;
+#endif
+
+    return ret;
+}
+
+bool
+is_digit(const char c) noexcept
+{
+    return c >= '0' && c <= '9';
+}
+
+// Best effort score of the pattern in the field, fzf v1 style: the
+// earliest end of a match is found forwards, then the latest start
+// backwards from it, which gives a short and tight alignment.
+int
+field_score(const char*       begin,
+            const char*       end,
+            const QByteArray& pattern) noexcept
+{
+    const char* const pat  = pattern.constData();
+    const int         plen = pattern.size();
+
+    const char* p = begin;
+    for(int k = 0; k < plen; ++k)
+    {
+        p = find_byte(p, end, pat[k]);
+        if(p == end) return -1;
+        ++p;
+    }
+
+    // backwards from the last letter
+    QVarLengthArray<const char*, 64> at(plen);
+    at[plen - 1] = p - 1;
+    for(int k = plen - 2; k >= 0; --k)
+    {
+        const char* q = at[k + 1] - 1;
+        while(*q != pat[k]) --q;
+        at[k] = q;
+    }
+
+    int score = 0;
+    for(int k = 0; k < plen; ++k)
+    {
+        const char* q = at[k];
+
+        int s = score_match;
+        if(q == begin || q[-1] == '_')
+            s += k == 0 ? 2 * bonus_boundary : bonus_boundary;
+        else if(is_digit(q[-1]) != is_digit(*q))
+            s += bonus_transition;
+
+        if(k > 0 && q == at[k - 1] + 1)
+            s += bonus_consecutive;
+        else if(k > 0)
+            s -= penalty_gap_start + penalty_gap * int(q - at[k - 1] - 2);
+
+        score += s;
+    }
+
+    return score;
+}
+} // namespace
+
+FuzzyIndex::FuzzyIndex(const Intrinsics& intrinsics)
+{
+    m_offsets.reserve(intrinsics.count() + 1);
+    m_masks.reserve((intrinsics.count() + 63) / 64 * 64);
+
+    for(const Intrinsic& i: intrinsics)
+    {
+        const int start = m_text.size();
+        m_offsets.append(start);
+
+        for(const QChar c: i.name) m_text.append(fold_char(c));
+        for(const Instruction& ins: i.instructions)
+        {
+            m_text.append(separator);
+            for(const QChar c: ins.name) m_text.append(fold_char(c));
+        }
+
+        m_masks.append(
+            class_mask(m_text.constData() + start, m_text.constEnd()));
+    }
+    m_offsets.append(m_text.size());
+
+    m_text.append(padding, '\0');
+    m_masks.resize((intrinsics.count() + 63) / 64 * 64);
+}
+
+QByteArray
+FuzzyIndex::fold(const QString& pattern)
+{
+    QByteArray ret;
+    ret.reserve(pattern.size());
+
+    for(const QChar c: pattern)
+        if(!c.isSpace() && c != separator) ret.append(fold_char(c));
+
+    return ret;
+}
+
+int
+FuzzyIndex::score(const QByteArray& pattern, const int position) const noexcept
+{
+    const char* field = m_text.constData() + m_offsets[position];
+    const char* end   = m_text.constData() + m_offsets[position + 1];
+
+    int best = -1;
+    for(bool name = true; field < end; name = false)
+    {
+        const char* field_end = find_byte(field, end, separator);
+        const int   s         = field_score(field, field_end, pattern);
+        if(s >= 0) best = std::max(best, name ? s : s - penalty_mnemonic);
+        field = field_end + 1;
+    }
+
+    return best;
+}
+
+Bitset
+FuzzyIndex::find(const QString&          pattern,
+                 const Bitset&           candidates,
+                 const std::atomic_bool* cancel) const
+{
+    const QByteArray folded = fold(pattern);
+    if(folded.isEmpty()) return candidates;
+
+    const quint64 need = class_mask(folded.cbegin(), folded.cend());
+
+    // checks the flag once per this many words of candidates
+    static constexpr int cancel_period = 16;
+
+    Bitset ret(candidates.size());
+    for(int wi = 0; wi < candidates.wordCount(); ++wi)
+    {
+        if(cancel && wi % cancel_period == 0 && cancel->load()) break;
+
+        quint64 w = candidates.word(wi);
+        if(!w) continue;
+
+        w &= mask_hits(m_masks.constData() + wi * 64, need);
+        for(quint64 bits = w; bits; bits &= bits - 1)
+        {
+            const int n = wi * 64 + qCountTrailingZeroBits(bits);
+            if(score(folded, n) < 0) w &= ~(quint64(1) << (n % 64));
+        }
+
+        ret.setWord(wi, w);
+    }
+
+    return ret;
+}
+
+QVector<int>
+FuzzyIndex::rank(const QString& pattern,
+                 const Bitset&  matches,
+                 const int      k) const
+{
+    struct Scored
+    {
+        int score;
+        int length;
+        int position;
+    };
+
+    const QByteArray folded = fold(pattern);
+
+    QVector<Scored> scored;
+    scored.reserve(matches.count());
+    matches.forEach(
+        [&](const int n)
+        {
+            const char* name   = m_text.constData() + m_offsets[n];
+            const char* end    = m_text.constData() + m_offsets[n + 1];
+            const int   length = int(find_byte(name, end, separator) - name);
+            scored.append({score(folded, n), length, n});
+        });
+
+    const auto better = [](const Scored& lhs, const Scored& rhs) noexcept
+    {
+        if(lhs.score != rhs.score) return lhs.score > rhs.score;
+        if(lhs.length != rhs.length) return lhs.length < rhs.length;
+        return lhs.position < rhs.position;
+    };
+
+    const auto top = scored.begin() + std::min(k, scored.count());
+    std::partial_sort(scored.begin(), top, scored.end(), better);
+    std::sort(top,
+              scored.end(),
+              [](const Scored& lhs, const Scored& rhs) noexcept
+              { return lhs.position < rhs.position; });
+
+    QVector<int> ret;
+    ret.reserve(scored.count());
+    for(const Scored& s: scored) ret.append(s.position);
+
+    return ret;
+}
@@ -0,0 +1,74 @@
+// -*- C++ -*-
+// fuzzy.hpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "bitset.hpp"
+#include "parser.hpp"
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+
+// Fuzzy matching of names and instruction mnemonics, in the manner of fzf:
+// the pattern letters must appear in order, and matches are scored higher
+// for letters at word starts, such as after "_", and for runs of
+// consecutive letters, lower for gaps. Spaces in the pattern are ignored.
+//
+// The texts are kept lower case in one buffer. A pattern first weeds the
+// intrinsics out by masks of the character classes they contain, 64 at a
+// time, then the survivors are scanned for the letters 16 bytes at a time.
+class FuzzyIndex
+{
+    // fields of every intrinsic separated by '\n', name first, followed by
+    // padding for the vector loads
+    QByteArray m_text;
+
+    // start of the fields of every intrinsic and the end of the last
+    QVector<int> m_offsets;
+
+    // character classes of every intrinsic, padded to whole words
+    QVector<quint64> m_masks;
+
+  public:
+    FuzzyIndex() = default;
+
+    explicit FuzzyIndex(const Intrinsics& intrinsics);
+
+    // Candidates matching the pattern. Stops early once the cancel flag is
+    // raised, the result is incomplete then.
+    Bitset
+    find(const QString&          pattern,
+         const Bitset&           candidates,
+         const std::atomic_bool* cancel = nullptr) const;
+
+    // score of the best matching field, -1 if none matches
+    int
+    score(const QByteArray& pattern, const int position) const noexcept;
+
+    // Positions of the matches, the best k by score first, shorter names
+    // and then earlier positions winning ties, the rest by position.
+    QVector<int>
+    rank(const QString& pattern, const Bitset& matches, const int k) const;
+
+    // the pattern as matched against the texts
+    static QByteArray
+    fold(const QString& pattern);
+};
@@ -0,0 +1,472 @@
+// -*- C++ -*-
+// index.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "index.hpp"
+
+#include <QRegularExpression>
+
+#include <algorithm>
+#include <utility>
+
+// searches matched exactly start with it
+static const QChar exact_prefix('\'');
+
+// searches of descriptions and operations start with it
+static const QChar text_prefix('?');
+
+static QVector<Bitset>
+symbol_bitsets(const SymbolTable& table, const int count)
+{
+    return QVector<Bitset>(table.count(), Bitset(count));
+}
+
+static Bitset&
+keyed_bitset(QHash<QString, Bitset>& bitsets, const QString& key, int count)
+{
+    const QString lower = key.toLower();
+
+    auto it = bitsets.find(lower);
+    if(it == bitsets.end()) it = bitsets.insert(lower, Bitset(count));
+
+    return *it;
+}
+
+FilterIndex::FilterIndex(const Intrinsics&              intrinsics,
+                         std::shared_ptr<const Symbols> symbols) :
+    p_symbols(std::move(symbols)),
+    m_trigrams(intrinsics),
+    m_fuzzy(intrinsics),
+    m_signatures(intrinsics),
+    m_all(intrinsics.count(), true),
+    m_techs(symbol_bitsets(p_symbols->techs, intrinsics.count())),
+    m_categories(symbol_bitsets(p_symbols->categories, intrinsics.count())),
+    m_rets(symbol_bitsets(p_symbols->rets, intrinsics.count())),
+    m_cpuids(symbol_bitsets(p_symbols->cpuids, intrinsics.count())),
+    m_text_source(intrinsics)
+{
+    for(int n = 0; n < intrinsics.count(); ++n)
+    {
+        const Intrinsic& i = intrinsics[n];
+        m_techs[i.tech].set(n);
+        m_categories[i.category].set(n);
+        m_rets[i.ret_type].set(n);
+        for(int id = 0; id < m_cpuids.count(); ++id)
+            if(i.cpuids.test(static_cast<std::size_t>(id)))
+                m_cpuids[id].set(n);
+
+        for(const Instruction& ins: i.instructions)
+            keyed_bitset(m_instructions, ins.name, intrinsics.count()).set(n);
+    }
+}
+
+// union of the bitsets of the named symbols
+static Bitset
+any_of(const QVector<Bitset>& bitsets,
+       const SymbolTable&     table,
+       const QSet<QString>&   names,
+       Bitset                 ret)
+{
+    for(const QString& name: names)
+    {
+        const SymbolID id = table.find(name);
+        if(id != SymbolTable::none) ret |= bitsets[id];
+    }
+
+    return ret;
+}
+
+namespace
+{
+// Whether a name matches the value of a term, ignoring the case. Values
+// with * or ? are wildcard patterns.
+class NameMatcher
+{
+    QString            m_value;
+    QRegularExpression m_pattern;
+
+  public:
+    explicit NameMatcher(const QString& value) : m_value(value)
+    {
+        if(value.contains('*') || value.contains('?'))
+            m_pattern = QRegularExpression(
+                QRegularExpression::wildcardToRegularExpression(value),
+                QRegularExpression::CaseInsensitiveOption);
+    }
+
+    bool
+    isPattern() const noexcept
+    {
+        return !m_pattern.pattern().isEmpty();
+    }
+
+    bool
+    operator()(const QString& name) const
+    {
+        return isPattern() ?
+                   m_pattern.match(name).hasMatch() :
+                   name.compare(m_value, Qt::CaseInsensitive) == 0;
+    }
+};
+
+// How much a term costs to match: a lookup of a ready bitset, a scan of
+// the keys or of the signatures, or a search of the names.
+enum Cost
+{
+    LOOKUP,
+    SCAN,
+    SEARCH
+};
+
+// Set operation of a query plan. Steps of lookups have their set ready and
+// know its size, the others match their terms once the plan reaches them.
+struct Step
+{
+    Bitset                    set;
+    QVector<const QueryTerm*> terms;
+    Cost                      cost    = LOOKUP;
+    int                       count   = 0;
+    bool                      exclude = false;
+};
+} // namespace
+
+// Union of the bitsets of the symbols matching the value. A value naming
+// a symbol exactly is not a pattern, so pointer types stay exact.
+static Bitset
+symbols_matching(const QVector<Bitset>& bitsets,
+                 const SymbolTable&     table,
+                 const QString&         value,
+                 Bitset                 ret)
+{
+    const SymbolID id = table.find(value);
+    if(id != SymbolTable::none)
+    {
+        ret |= bitsets[id];
+        return ret;
+    }
+
+    const NameMatcher matches(value);
+    for(int n = 0; n < table.count(); ++n)
+        if(matches(table[SymbolID(n)])) ret |= bitsets[n];
+
+    return ret;
+}
+
+// union of the bitsets of the keys matching the value
+static Bitset
+keys_matching(const QHash<QString, Bitset>& bitsets,
+              const QString&                value,
+              Bitset                        ret)
+{
+    const auto found = bitsets.constFind(value.toLower());
+    if(found != bitsets.cend())
+    {
+        ret |= *found;
+        return ret;
+    }
+
+    const NameMatcher matches(value);
+    if(matches.isPattern())
+        for(auto it = bitsets.cbegin(); it != bitsets.cend(); ++it)
+            if(matches(it.key())) ret |= *it;
+
+    return ret;
+}
+
+int
+FilterIndex::termCost(const QueryTerm& term) const
+{
+    const auto lookup_if = [](const bool found)
+    { return found ? LOOKUP : SCAN; };
+
+    switch(term.field)
+    {
+    case QueryTerm::SEARCH:
+        return SEARCH;
+    case QueryTerm::RET:
+        return lookup_if(p_symbols->rets.find(term.value) != SymbolTable::none);
+    case QueryTerm::TECH:
+        return lookup_if(p_symbols->techs.find(term.value) !=
+                         SymbolTable::none);
+    case QueryTerm::CPUID:
+        return lookup_if(p_symbols->cpuids.find(term.value) !=
+                         SymbolTable::none);
+    case QueryTerm::CATEGORY:
+        return lookup_if(p_symbols->categories.find(term.value) !=
+                         SymbolTable::none);
+    case QueryTerm::PARAM:
+        return lookup_if(m_signatures.types().contains(
+            SignatureIndex::normalType(term.value)));
+    case QueryTerm::INSTRUCTION:
+        return lookup_if(m_instructions.contains(term.value.toLower()));
+    case QueryTerm::SIGNATURE:
+        return SCAN;
+    }
+
+    return SCAN;
+}
+
+Bitset
+FilterIndex::termMatch(const QueryTerm&        term,
+                       const Bitset&           within,
+                       Bitset                  ret,
+                       const std::atomic_bool* cancel) const
+{
+    switch(term.field)
+    {
+    case QueryTerm::SEARCH:
+        ret |= m_trigrams.find(term.value, within, cancel);
+        return ret;
+    case QueryTerm::RET:
+        return symbols_matching(
+            m_rets, p_symbols->rets, term.value, std::move(ret));
+    case QueryTerm::TECH:
+        return symbols_matching(
+            m_techs, p_symbols->techs, term.value, std::move(ret));
+    case QueryTerm::CPUID:
+        return symbols_matching(
+            m_cpuids, p_symbols->cpuids, term.value, std::move(ret));
+    case QueryTerm::CATEGORY:
+        return symbols_matching(
+            m_categories, p_symbols->categories, term.value, std::move(ret));
+    case QueryTerm::PARAM:
+    {
+        const QHash<QString, Bitset>& types = m_signatures.types();
+
+        const auto it = types.constFind(SignatureIndex::normalType(term.value));
+        if(it == types.cend())
+            return keys_matching(types, term.value, std::move(ret));
+
+        ret |= *it;
+        return ret;
+    }
+    case QueryTerm::INSTRUCTION:
+        return keys_matching(m_instructions, term.value, std::move(ret));
+    case QueryTerm::SIGNATURE:
+        ret |= m_signatures.find(term.value);
+        return ret;
+    }
+
+    return ret;
+}
+
+Bitset
+FilterIndex::match(const Query& query, const std::atomic_bool* cancel) const
+{
+    const int count = m_all.size();
+    Bitset    ret   = m_all;
+
+    if(!p_symbols) return ret;
+
+    QVector<Step> plan;
+    const auto    add_step = [&](Bitset set, const bool exclude = false)
+    {
+        const int n = set.count();
+        plan.append({std::move(set), {}, LOOKUP, n, exclude});
+    };
+
+    if(!(query.techs.isEmpty() && query.cpuids.isEmpty()))
+    {
+        Bitset techs =
+            any_of(m_techs, p_symbols->techs, query.techs, Bitset(count));
+        add_step(any_of(
+            m_cpuids, p_symbols->cpuids, query.cpuids, std::move(techs)));
+
+        // SVML intrinsics have a lot of CPUID flags
+        // we don't wanna show them when it is not selected
+        static const QString svml("SVML");
+        const SymbolID       svml_id = p_symbols->techs.find(svml);
+        if(svml_id != SymbolTable::none && !query.techs.contains(svml))
+            add_step(m_techs[svml_id], true);
+    }
+
+    if(!query.categories.isEmpty())
+        add_step(any_of(m_categories,
+                        p_symbols->categories,
+                        query.categories,
+                        Bitset(count)));
+
+    if(query.ret != "*")
+    {
+        const SymbolID id = p_symbols->rets.find(query.ret);
+        add_step(id != SymbolTable::none ? m_rets[id] : Bitset(count));
+    }
+
+    // Terms of a field match any of their values. Terms of lookups are
+    // matched now, the others only once the plan reaches them.
+    const auto add_terms =
+        [&](QVector<const QueryTerm*> terms, const bool exclude)
+    {
+        Cost cost = LOOKUP;
+        for(const QueryTerm* term: terms)
+            cost = std::max(cost, Cost(termCost(*term)));
+
+        if(cost != LOOKUP)
+        {
+            plan.append({Bitset(), std::move(terms), cost, count, exclude});
+            return;
+        }
+
+        Bitset set(count);
+        for(const QueryTerm* term: terms)
+            set = termMatch(*term, m_all, std::move(set), cancel);
+        add_step(std::move(set), exclude);
+    };
+
+    QVector<QVector<const QueryTerm*>> fields(QueryTerm::SIGNATURE + 1);
+    for(const QueryTerm& term: query.terms)
+        if(term.exclude)
+            add_terms({&term}, true);
+        else
+            fields[term.field].append(&term);
+
+    for(QVector<const QueryTerm*>& terms: fields)
+        if(!terms.isEmpty()) add_terms(std::move(terms), false);
+
+    // The cheapest steps first, so an empty result skips the scans and
+    // searches. Among those the narrowest first, exclusions once the
+    // result is small.
+    std::sort(plan.begin(),
+              plan.end(),
+              [](const Step& a, const Step& b)
+              {
+                  if(a.cost != b.cost) return a.cost < b.cost;
+                  return a.exclude != b.exclude ? b.exclude :
+                                                  a.count < b.count;
+              });
+
+    for(Step& step: plan)
+    {
+        if(cancel && cancel->load()) return ret;
+
+        // searches of the terms only look at what is left
+        if(!step.terms.isEmpty())
+        {
+            step.set = Bitset(count);
+            for(const QueryTerm* term: step.terms)
+                step.set = termMatch(*term, ret, std::move(step.set), cancel);
+        }
+
+        if(step.exclude)
+            ret.andNot(step.set);
+        else
+            ret &= step.set;
+
+        if(!ret.any()) return ret;
+    }
+
+    if(!query.search.isEmpty()) ret &= search(query.search, ret, cancel);
+
+    return ret;
+}
+
+Bitset
+FilterIndex::search(const QString&          search,
+                    const std::atomic_bool* cancel) const
+{
+    return this->search(search, m_all, cancel);
+}
+
+Bitset
+FilterIndex::search(const QString&          search,
+                    const Bitset&           within,
+                    const std::atomic_bool* cancel) const
+{
+    const QString key   = search.toCaseFolded();
+    const bool    whole = within == m_all;
+
+    // matches of the longest cached search the new one contains
+    Bitset candidates = m_all;
+    {
+        QMutexLocker lock(&m_recent_mutex);
+
+        int base = -1;
+        for(int r = 0; r < m_recent.count(); ++r)
+        {
+            const QString& cached = m_recent[r].first;
+            if(cached == key)
+            {
+                m_recent.move(r, 0);
+                Bitset ret = m_recent.front().second;
+                ret &= within;
+                return ret;
+            }
+            // exact matches refine fuzzy ones but not the other way,
+            // adding words to a text search finds more
+            if(key.contains(cached) && !key.startsWith(text_prefix) &&
+               !cached.startsWith(text_prefix) &&
+               (key.startsWith(exact_prefix) ||
+                !cached.startsWith(exact_prefix)) &&
+               (base == -1 || cached.size() > m_recent[base].first.size()))
+                base = r;
+        }
+
+        if(base != -1) candidates = m_recent[base].second;
+    }
+
+    // Only what the filters leave is searched. The result of a restricted
+    // search can't serve other filters, so only unrestricted ones are
+    // cached, while restricted ones still start from the cache.
+    if(!whole) candidates &= within;
+
+    const Bitset found =
+        search.startsWith(exact_prefix) ?
+            m_trigrams.find(search.mid(1), candidates, cancel) :
+        search.startsWith(text_prefix) ?
+            text().find(search.mid(1), candidates) :
+            m_fuzzy.find(search, candidates, cancel);
+    if(!whole || (cancel && cancel->load())) return found;
+
+    QMutexLocker lock(&m_recent_mutex);
+    m_recent.prepend({key, found});
+    if(m_recent.count() > recent_searches) m_recent.removeLast();
+
+    return found;
+}
+
+QVector<int>
+FilterIndex::ranked(const Query& query, const std::atomic_bool* cancel) const
+{
+    const Bitset found = match(query, cancel);
+    if(cancel && cancel->load()) return {};
+
+    if(query.search.startsWith(text_prefix))
+        return text().rank(query.search.mid(1), found, ranked_matches);
+
+    if(query.search.isEmpty() || query.search.startsWith(exact_prefix))
+    {
+        QVector<int> ret;
+        ret.reserve(found.count());
+        found.forEach([&](const int n) { ret.append(n); });
+        return ret;
+    }
+
+    return m_fuzzy.rank(query.search, found, ranked_matches);
+}
+
+const TextIndex&
+FilterIndex::text() const
+{
+    std::call_once(m_text_once,
+                   [this]()
+                   {
+                       m_text = TextIndex(m_text_source);
+                       m_text_source.clear();
+                   });
+
+    return m_text;
+}
@@ -0,0 +1,138 @@
+// -*- C++ -*-
+// index.hpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "bitset.hpp"
+#include "fuzzy.hpp"
+#include "parser.hpp"
+#include "query.hpp"
+#include "signature.hpp"
+#include "textindex.hpp"
+#include "trigram.hpp"
+
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+// Bitsets of the intrinsics, one per symbol of every filtered field and
+// per instruction mnemonic, keyed in lower case, and of the signatures.
+// Bit positions are the positions in the intrinsics vector. The index is
+// immutable apart from the guarded search cache, so it may be queried from
+// several threads at once.
+class FilterIndex
+{
+    std::shared_ptr<const Symbols> p_symbols;
+    TrigramIndex                   m_trigrams;
+    FuzzyIndex                     m_fuzzy;
+    SignatureIndex                 m_signatures;
+    Bitset                         m_all;
+    QVector<Bitset>                m_techs;
+    QVector<Bitset>                m_categories;
+    QVector<Bitset>                m_rets;
+    QVector<Bitset>                m_cpuids;
+    QHash<QString, Bitset>         m_instructions;
+
+    // Results of the recent searches, the latest first, keyed by the case
+    // folded search string. A search extending a cached one only checks
+    // the cached matches, repeating one is a lookup.
+    static constexpr int                    recent_searches = 32;
+    mutable QVector<QPair<QString, Bitset>> m_recent;
+    mutable QMutex                          m_recent_mutex;
+
+    // text index built on the first use from the intrinsics given to the
+    // constructor, which are released then
+    mutable Intrinsics     m_text_source;
+    mutable TextIndex      m_text;
+    mutable std::once_flag m_text_once;
+
+    // Matches of the search among the candidates. A cached search serves
+    // any candidates, but only searches among all intrinsics are cached,
+    // others only look at the candidates.
+    Bitset
+    search(const QString&          search,
+           const Bitset&           within,
+           const std::atomic_bool* cancel) const;
+
+    // Cost of matching the term, a lookup of a ready bitset is the
+    // cheapest and a search of the names the most expensive.
+    int
+    termCost(const QueryTerm& term) const;
+
+    // the intrinsics matching the term added to ret, searches only look
+    // within the candidates
+    Bitset
+    termMatch(const QueryTerm&        term,
+              const Bitset&           within,
+              Bitset                  ret,
+              const std::atomic_bool* cancel) const;
+
+  public:
+    FilterIndex() = default;
+
+    FilterIndex(const FilterIndex&) = delete;
+
+    FilterIndex&
+    operator=(const FilterIndex&) = delete;
+
+    FilterIndex(const Intrinsics&              intrinsics,
+                std::shared_ptr<const Symbols> symbols);
+
+    int
+    count() const noexcept
+    {
+        return m_all.size();
+    }
+
+    // Intrinsics matching the query. The query is compiled into a plan of
+    // bitset operations ordered by their cost and by how much they narrow
+    // the result. Scans and searches run only on what is left and not at
+    // all once it is empty, the search runs last. A raised cancel flag stops
+    // the search early, the result is incomplete then and must be dropped.
+    Bitset
+    match(const Query& query, const std::atomic_bool* cancel = nullptr) const;
+
+    // Intrinsics fuzzily matching the search string by the name or by an
+    // instruction. A search starting with ' matches the rest exactly, as a
+    // case insensitive substring, one starting with ? matches any of the
+    // words of the rest in descriptions and operations.
+    Bitset
+    search(const QString&          search,
+           const std::atomic_bool* cancel = nullptr) const;
+
+    // Index of descriptions and operations. It is built on the first call,
+    // which blocks concurrent callers until it is done, so the window
+    // builds it in the background after loading.
+    const TextIndex&
+    text() const;
+
+    // best ranked matches of a fuzzy search sorted first
+    static constexpr int ranked_matches = 1000;
+
+    // Positions of the intrinsics matching the query, ordered by the score
+    // of a fuzzy or a text search, otherwise by position. Empty if
+    // cancelled.
+    QVector<int>
+    ranked(const Query& query, const std::atomic_bool* cancel = nullptr) const;
+};
@@ -16,18 +16,25 @@
 //    You should have received a copy of the GNU General Public License
 //    along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+#include "cli.hpp"
 #include "mainwindow.hpp"
 #include "parser.hpp"
+#include "server.hpp"
+#include "trace.hpp"
 
 #include <QApplication>
+#include <QCoreApplication>
 #include <QDir>
 #include <QElapsedTimer>
 #include <QFile>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QMessageBox>
 #include <QSettings>
 #include <QWidget>
 
+#include <optional>
+
 static const QString app_name("MinIGuide");
 
 // settings names
@@ -39,6 +46,7 @@ static const QString winsize("Window/winsize");
 static const QString split1("Window/split1");
 static const QString split2("Window/split2");
 static const QString winstate("Window/state");
+static const QString docks("Window/live_docks");
 
 static const QString search("Session/search");
 static const QString ret("Session/ret");
@@ -48,17 +56,52 @@ static const QString cpuids("Session/cpuids");
 static const QString intrs("Session/intrinsics");
 } // namespace st
 
+// the last used data file or the one next to the executable
+static QString
+default_data_path(const QSettings& settings)
+{
+    const QVariant data_path_v = settings.value(st::data);
+    if(data_path_v.canConvert<QString>()) return data_path_v.toString();
+
+    return QCoreApplication::applicationDirPath() + "/data-3-6-6.xml";
+}
+
 int
 main(int argc, char* argv[])
 {
+    QCoreApplication::setApplicationName(app_name);
+    QCoreApplication::setOrganizationName("MinIGuide Project");
+
+    // a trace of the whole run, from the flag or the environment
+    QString trace_path = option_value(argc, argv, "--trace");
+    if(trace_path.isEmpty())
+        trace_path = qEnvironmentVariable("MINIGUIDE_TRACE");
+    const trace::Session trace_session(trace_path);
+
+    const bool query  = option_given(argc, argv, "--query");
+    const bool serve  = option_given(argc, argv, "--serve");
+    const bool disasm = option_given(argc, argv, "--disasm");
+    const bool diff   = option_given(argc, argv, "--diff");
+    if(query || serve || disasm || diff)
+    {
+        QCoreApplication app(argc, argv);
+        QSettings        settings;
+        ParseOptions     options;
+        options.snapshot_dir = QFileInfo(settings.fileName()).absolutePath();
+
+        const QString data_path = default_data_path(settings);
+        return query  ? run_query(app.arguments(), data_path, options) :
+               disasm ? run_disasm(app.arguments(), data_path, options) :
+               diff   ? run_diff(app.arguments(), options) :
+                        run_server(app.arguments(), data_path, options);
+    }
+
     QApplication app(argc, argv);
-    QApplication::setApplicationName(app_name);
-    QApplication::setOrganizationName("MinIGuide Project");
 
-    QString data_path = QApplication::applicationDirPath() + "/data-3-6-6.xml";
     QSettings settings;
-    QVariant  data_path_v = settings.value(st::data);
-    if(data_path_v.canConvert<QString>()) data_path = data_path_v.toString();
+    QString   data_path = default_data_path(settings);
+
+    std::optional<trace::Scope> startup_scope(std::in_place, "startup");
 
     MainWindow window;
 
@@ -70,6 +113,7 @@ main(int argc, char* argv[])
         settings.setValue(st::split1, split1);
         settings.setValue(st::split2, split2);
         settings.setValue(st::winstate, window.saveState());
+        settings.setValue(st::docks, window.maxLiveDocks());
         settings.setValue(st::search, window.searchText());
         settings.setValue(st::ret, window.selectedRet());
         settings.setValue(st::techs,
@@ -79,6 +123,8 @@ main(int argc, char* argv[])
         settings.setValue(st::cpuids,
                           QStringList(window.selectedCPUIDs().values()));
         settings.setValue(st::intrs, window.shownIntrinsics());
+
+        window.dumpMetrics();
     };
 
     QObject::connect(&app, &QApplication::aboutToQuit, settings_saver);
@@ -102,7 +148,10 @@ main(int argc, char* argv[])
         QElapsedTimer timer;
         timer.start();
 
-        const ParseData data = parse_doc(&data_file);
+        ParseOptions options;
+        options.snapshot_dir = QFileInfo(settings.fileName()).absolutePath();
+
+        const ParseData data = parse_doc(&data_file, options);
         data_v               = data.version;
         data_d               = data.date;
 
@@ -112,7 +161,7 @@ main(int argc, char* argv[])
         window.fillTechTree(data.technologies);
         window.fillCategoriesList(data.categories);
         window.fillRetCombo(data.rets);
-        window.addIntrinsics(data.intrinsics);
+        window.addIntrinsics(data.intrinsics, data.symbols);
 
         qInfo("Initialized GUI in %.03f seconds",
               static_cast<float>(timer.elapsed()) / 1000.f);
@@ -123,24 +172,14 @@ main(int argc, char* argv[])
         msg.setWindowTitle("Error");
         msg.setIcon(QMessageBox::Critical);
         msg.setText("Failed to parse data");
-        switch(ex.reason)
-        {
-        case ParsingError::NOT_OPEN:
-        {
-            msg.setDetailedText("Could not open file.");
-            break;
-        }
-        case ParsingError::NOT_IIDATA:
-        {
-            msg.setDetailedText("Incorrect data format.");
-            break;
-        }
-        }
+        msg.setDetailedText(error_text(ex));
         msg.exec();
     }
 
     // loading settings
     {
+        TRACE_SCOPE("restore settings");
+
         window.resize(settings.value(st::winsize, QSize(640, 480)).toSize());
 
         const QVariant s1 = settings.value(st::split1);
@@ -151,6 +190,9 @@ main(int argc, char* argv[])
         const QVariant ws = settings.value(st::winstate);
         if(ws.isValid()) window.restoreState(ws.toByteArray());
 
+        window.setMaxLiveDocks(
+            settings.value(st::docks, window.maxLiveDocks()).toInt());
+
         // session
         window.setSearch(settings.value(st::search, "").toString());
         window.selectRet(settings.value(st::ret, "*").toString());
@@ -174,5 +216,7 @@ main(int argc, char* argv[])
     window.connectSignals();
     window.initialFilter();
 
+    startup_scope.reset();
+
     return app.exec();
 }
@@ -18,21 +18,31 @@
 
 #include "mainwindow.hpp"
 #include "details.hpp"
+#include "trace.hpp"
 
+#include <QAction>
 #include <QBrush>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QFont>
 #include <QHBoxLayout>
+#include <QKeySequence>
 #include <QLabel>
 #include <QLinearGradient>
 #include <QList>
-#include <QTabBar>
+#include <QRect>
+#include <QScrollBar>
+#include <QShortcut>
 #include <QVBoxLayout>
 #include <QWidget>
+#include <QtConcurrent>
 
 #include <functional>
+#include <utility>
 
 MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
 {
-    p_search_edit->setPlaceholderText("_mm_search or instruction");
+    p_search_edit->setPlaceholderText("_mm_search, instruction or cpuid:AVX2");
     p_search_edit->setClearButtonEnabled(true);
 
     QHBoxLayout* search_lay = new QHBoxLayout;
@@ -61,6 +71,9 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
     p_left_split->addWidget(techs_widget);
     p_left_split->addWidget(cats_widget);
 
+    p_name_list->setModel(p_model);
+    p_name_list->setUniformItemSizes(true);
+
     p_top_split->setChildrenCollapsible(false);
     p_top_split->setSizePolicy(p_name_list->sizePolicy());
     p_top_split->addWidget(p_left_split);
@@ -78,49 +91,93 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
 
     setDockOptions(AnimatedDocks | AllowTabbedDocks);
     setTabPosition(Qt::AllDockWidgetAreas, QTabWidget::North);
-}
-
-QString
-format_parms(const QVector<Var>& parms) noexcept
-{
-    QStringList varlist;
 
-    for(const Var& var: parms) varlist.append(var.type + ' ' + var.name);
+    p_filter_timer->setSingleShot(true);
+    p_filter_timer->setInterval(0);
+    QObject::connect(
+        p_filter_timer, &QTimer::timeout, this, &MainWindow::startFilter);
+    QObject::connect(p_filter_watcher,
+                     &QFutureWatcherBase::finished,
+                     this,
+                     &MainWindow::filterFinished);
+
+    // hidden debug dock with the latency histograms
+    p_metrics_text->setReadOnly(true);
+    p_metrics_text->setFont(QFont("Monospace"));
+    p_metrics_text->setLineWrapMode(QPlainTextEdit::NoWrap);
+    p_metrics_dock->setObjectName("metrics");
+    p_metrics_dock->setWidget(p_metrics_text);
+    addDockWidget(Qt::BottomDockWidgetArea, p_metrics_dock);
+    p_metrics_dock->hide();
+
+    p_metrics_timer->setInterval(500);
+    QObject::connect(p_metrics_timer,
+                     &QTimer::timeout,
+                     this,
+                     [this]()
+                     { p_metrics_text->setPlainText(m_metrics.report()); });
+    QObject::connect(p_metrics_dock,
+                     &QDockWidget::visibilityChanged,
+                     this,
+                     [this](const bool visible)
+                     {
+                         if(visible)
+                             p_metrics_timer->start();
+                         else
+                             p_metrics_timer->stop();
+                     });
+    QObject::connect(new QShortcut(QKeySequence("Ctrl+Shift+M"), this),
+                     &QShortcut::activated,
+                     p_metrics_dock->toggleViewAction(),
+                     &QAction::trigger);
+
+    p_changes_dock->setObjectName("changes");
+    p_changes_dock->setWidget(p_changes_list);
+    addDockWidget(Qt::BottomDockWidgetArea, p_changes_dock);
+    p_changes_dock->hide();
+
+    QObject::connect(new QShortcut(QKeySequence("Ctrl+Shift+D"), this),
+                     &QShortcut::activated,
+                     this,
+                     &MainWindow::compareData);
+    QObject::connect(p_compare_watcher,
+                     &QFutureWatcherBase::finished,
+                     this,
+                     &MainWindow::showChanges);
+    QObject::connect(p_changes_list,
+                     &QListWidget::itemActivated,
+                     this,
+                     [this](QListWidgetItem* item)
+                     {
+                         const QVariant position = item->data(Qt::UserRole);
+                         if(position.isValid()) showIntrinsic(position.toInt());
+                     });
 
-    return varlist.join(' ');
+    QObject::connect(p_name_list,
+                     &IntrinsicsView::painted,
+                     this,
+                     [this](const qint64 nsecs)
+                     { m_metrics.record("list paint", nsecs); });
 }
 
-static constexpr inline int id_role = 1000;
-
-QString
-intrinsicID(const Intrinsic& i)
+void
+MainWindow::addIntrinsics(const Intrinsics&              intrinsics,
+                          std::shared_ptr<const Symbols> symbols)
 {
-    static const QString id_template("%1 (%2: %3)");
-
-    QStringList cpuids = i.cpuids.values();
+    TRACE_SCOPE("addIntrinsics");
 
-    return id_template.arg(i.name, i.tech, cpuids.join('+'));
-};
+    p_symbols = std::move(symbols);
+    p_index   = std::make_shared<const FilterIndex>(intrinsics, p_symbols);
 
-void
-MainWindow::addIntrinsics(const Intrinsics& intrinsics)
-{
-    m_intrinsics_widgets.reserve(intrinsics.count());
-    m_intrinsics_map.reserve(intrinsics.count());
+    // the text index reads every description, it's ready by the time
+    // anyone searches them
+    QtConcurrent::run([index = p_index]() { index->text(); });
 
-    for(const Intrinsic& i: intrinsics)
-    {
-        const QString tooltip =
-            QString("%1 %2(%3)").arg(i.ret_type, i.name, format_parms(i.parms));
-        const QString    id   = intrinsicID(i);
-        QListWidgetItem* item = new QListWidgetItem(i.name);
-        item->setData(id_role, id);
-        item->setToolTip(tooltip);
-        item->setBackground(techBrush(i.tech));
-        m_intrinsics_widgets.append(item);
-        p_name_list->addItem(item);
-        m_intrinsics_map.insert(id, i);
-    }
+    p_model->setIntrinsics(intrinsics,
+                           p_symbols,
+                           [this](const QString& tech)
+                           { return techBrush(tech); });
+    p_details_cache->setIntrinsics(intrinsics, p_symbols);
 }
 
 QString
@@ -220,60 +277,83 @@ MainWindow::selectCategories(const QStringList& ss)
                    std::mem_fn(&QListWidgetItem::setCheckState));
 }
 
-bool
-match_instructions(const QString&              search,
-                   const QVector<Instruction>& instructions) noexcept
+Query
+MainWindow::query() const
 {
-    bool ret = false;
-
-    for(const Instruction& i: instructions)
-        ret |= i.name.contains(search, Qt::CaseInsensitive);
-
+    Query ret      = parse_query(searchText());
+    ret.ret        = selectedRet();
+    ret.techs      = selectedTechs();
+    ret.cpuids     = selectedCPUIDs();
+    ret.categories = selectedCategories();
     return ret;
 }
 
 void
-MainWindow::filter()
+MainWindow::filter(const char* trigger)
 {
-    const QString       search   = searchText();
-    const QString       ret_type = selectedRet();
-    const QSet<QString> techs    = selectedTechs();
-    const QSet<QString> cpuids   = selectedCPUIDs();
-    const QSet<QString> cats     = selectedCategories();
+    if(!m_filter_clock.isValid()) m_filter_clock.start();
+    p_filter_trigger = trigger;
 
-    static const QString svml("SVML");
+    p_filter_timer->start();
+}
 
-    for(QListWidgetItem* item: m_intrinsics_widgets)
+void
+MainWindow::startFilter()
+{
+    if(p_filter_watcher->isRunning())
     {
-        const Intrinsic& i     = intrinsic(item);
-        const QString    iname = item->text();
+        m_filter_pending = true;
+        p_filter_cancel->store(true);
+        return;
+    }
 
-        const bool search_match = search.isEmpty() ||
-                                  iname.contains(search, Qt::CaseInsensitive) ||
-                                  match_instructions(search, i.instructions);
-        const bool cat_match  = cats.empty() || cats.contains(i.category);
-        const bool tech_match = (techs.empty() && cpuids.empty()) ||
-                                techs.contains(i.tech) ||
-                                cpuids.intersects(i.cpuids);
+    m_filter_pending = false;
+    p_filter_cancel  = std::make_shared<std::atomic_bool>(false);
 
-        // SVML intrinsics have a lot of CPUID flags
-        // we don't wanna show them when it is not selected
-        const bool svml_match = (i.tech != svml) ||
-                                (techs.empty() && cpuids.empty()) ||
-                                techs.contains(svml);
+    p_filter_watcher->setFuture(QtConcurrent::run(
+        [index = p_index, q = query(), cancel = p_filter_cancel]()
+        {
+            TRACE_SCOPE("match");
+            return index->ranked(q, cancel.get());
+        }));
+}
 
-        const bool ret_match = (ret_type == "*") || ret_type == i.ret_type;
+void
+MainWindow::filterFinished()
+{
+    TRACE_SCOPE("filterFinished");
 
-        const bool match =
-            search_match && tech_match && cat_match && svml_match && ret_match;
+    if(m_filter_pending)
+    {
+        startFilter();
+        return;
+    }
 
-        item->setHidden(!match);
+    // the reset loses the current row, it's kept if it is still shown
+    const QModelIndex current = p_name_list->currentIndex();
+    const int         position =
+        current.isValid() ? p_model->position(current.row()) : -1;
+
+    p_model->setShown(p_filter_watcher->result());
+
+    const int row = position != -1 ? p_model->row(position) : -1;
+    if(row != -1 && row != p_name_list->currentIndex().row())
+    {
+        const QModelIndex index = p_model->index(row);
+        p_name_list->setCurrentIndex(index);
+        p_name_list->scrollTo(index);
     }
+
+    m_metrics.record(QString("filter %1").arg(p_filter_trigger),
+                     m_filter_clock.nsecsElapsed());
+    m_filter_clock.invalidate();
 }
 
 void
 MainWindow::fillCategoriesList(const QStringList& categories)
 {
+    TRACE_SCOPE("fillCategoriesList");
+
     for(const QString& c: categories)
     {
         QListWidgetItem* item = new QListWidgetItem(c);
@@ -287,6 +367,8 @@ MainWindow::fillCategoriesList(const QStringList& categories)
 void
 MainWindow::fillTechTree(const QVector<Tech>& technologies)
 {
+    TRACE_SCOPE("fillTechTree");
+
     // filling colormap
     const int num_clrs = technologies.count() - 2;
     int       h        = 59;
@@ -326,6 +408,8 @@ MainWindow::fillTechTree(const QVector<Tech>& technologies)
 void
 MainWindow::fillRetCombo(const QStringList& rets)
 {
+    TRACE_SCOPE("fillRetCombo");
+
     p_ret_combo->addItems(rets);
 }
 
@@ -355,44 +439,107 @@ MainWindow::restoreSplittersState(const QByteArray& s1, const QByteArray& s2)
 }
 
 void
-MainWindow::showIntrinsic(const Intrinsic& i)
+MainWindow::showIntrinsic(const int position)
 {
-    const QString iid = intrinsicID(i);
-    if(m_dock_widgets.contains(iid))
-    {
-        m_dock_widgets[iid]->show();
-        m_dock_widgets[iid]->setFocus(Qt::OtherFocusReason);
-    }
-    else
+    TRACE_SCOPE("showIntrinsic");
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const Intrinsic& i   = p_model->intrinsics()[position];
+    const QString    iid = intrinsicID(i, *p_symbols);
+    QDockWidget*     dw  = m_dock_widgets.value(iid, nullptr);
+
+    if(!dw)
     {
-        static const QString stylesheet_template(
-            "#idetails {border: 3px inset %1;}");
-        IntrinsicDetails* idw = new IntrinsicDetails(i);
-        QDockWidget*      dw  = new QDockWidget(iid);
-        const QColor      clr = m_colormap.value(i.tech, Qt::gray);
-        idw->setStyleSheet(stylesheet_template.arg(clr.name()));
+        dw = new QDockWidget(iid);
         dw->setObjectName(iid);
-        dw->setWidget(idw);
         dw->setAllowedAreas(Qt::RightDockWidgetArea);
         addDockWidget(Qt::RightDockWidgetArea, dw);
-        if(!m_dock_widgets.empty())
-            tabifyDockWidget(m_dock_widgets.values().back(), dw);
+        if(p_last_dock) tabifyDockWidget(p_last_dock, dw);
+        p_last_dock = dw;
         m_dock_widgets.insert(iid, dw);
+        m_dock_positions.insert(dw, position);
+        QObject::connect(dw,
+                         &QDockWidget::visibilityChanged,
+                         this,
+                         [this, dw](const bool visible)
+                         {
+                             if(visible) activateDock(dw);
+                         });
     }
 
-    for(QTabBar* tab: findChildren<QTabBar*>("", Qt::FindDirectChildrenOnly))
-        for(int ti = 0; ti < tab->count(); ++ti)
-            if(tab->tabText(ti) == iid)
-            {
-                tab->setCurrentIndex(ti);
-                return;
-            }
+    activateDock(dw);
+    dw->show();
+    dw->raise();
+    dw->setFocus(Qt::OtherFocusReason);
+
+    m_metrics.record("dock show", timer.nsecsElapsed());
+}
+
+void
+MainWindow::activateDock(QDockWidget* dw)
+{
+    if(m_live_docks.value(0) == dw) return;
+
+    if(m_live_docks.removeOne(dw))
+    {
+        m_live_docks.prepend(dw);
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    dw->setWidget(makeDetails(m_dock_positions[dw]));
+    m_live_docks.prepend(dw);
+
+    m_metrics.record("dock build", timer.nsecsElapsed());
+
+    // visible docks are kept even past the cap
+    for(int n = m_live_docks.count() - 1;
+        n > 0 && m_live_docks.count() > m_max_live_docks;
+        --n)
+    {
+        QDockWidget* evicted = m_live_docks[n];
+        if(evicted->isVisible()) continue;
+
+        QWidget* idw = evicted->widget();
+        evicted->setWidget(nullptr);
+        idw->deleteLater();
+        m_live_docks.removeAt(n);
+    }
+}
+
+IntrinsicDetails*
+MainWindow::makeDetails(const int position) const
+{
+    static const QString stylesheet_template(
+        "#idetails {border: 3px inset %1;}");
+
+    const Intrinsic&  i   = p_model->intrinsics()[position];
+    IntrinsicDetails* idw =
+        new IntrinsicDetails(p_details_cache->details(position));
+    const QColor clr = m_colormap.value(p_symbols->techs[i.tech], Qt::gray);
+    idw->setStyleSheet(stylesheet_template.arg(clr.name()));
+
+    return idw;
 }
 
-const Intrinsic&
-MainWindow::intrinsic(QListWidgetItem* item)
+int
+MainWindow::findIntrinsic(const QString& iid) const
 {
-    return m_intrinsics_map[item->data(id_role).toString()];
+    // IDs start with the name, so only the namesakes are formatted
+    const QString     name       = iid.left(iid.indexOf(" ("));
+    const QString     normal     = normalIntrinsicID(iid);
+    const Intrinsics& intrinsics = p_model->intrinsics();
+
+    for(int n = 0; n < intrinsics.count(); ++n)
+        if(intrinsics[n].name == name &&
+           intrinsicID(intrinsics[n], *p_symbols) == normal)
+            return n;
+
+    return -1;
 }
 
 QStringList
@@ -410,9 +557,146 @@ MainWindow::shownIntrinsics() const
 void
 MainWindow::showIntrinsics(const QStringList& ins)
 {
-    for(const QString& in: ins) showIntrinsic(m_intrinsics_map[in]);
+    TRACE_SCOPE("showIntrinsics");
+
+    // docks saved under IDs of an earlier order are restored by those
+    QHash<QDockWidget*, QString> saved_names;
+    for(const QString& in: ins)
+    {
+        const int position = findIntrinsic(in);
+        if(position == -1) continue;
+
+        showIntrinsic(position);
+
+        const QString iid =
+            intrinsicID(p_model->intrinsics()[position], *p_symbols);
+        if(iid != in) saved_names.insert(m_dock_widgets.value(iid), in);
+    }
+
+    for(QDockWidget* dw: m_dock_widgets)
+    {
+        const QString iid = dw->objectName();
+        dw->setObjectName(saved_names.value(dw, iid));
+        restoreDockWidget(dw);
+        dw->setObjectName(iid);
+    }
+}
+
+void
+MainWindow::dumpMetrics() const
+{
+    if(!m_metrics.isEmpty())
+        qInfo("Latencies:\n%s", qUtf8Printable(m_metrics.report()));
+}
+
+void
+MainWindow::compareData()
+{
+    if(p_compare_watcher->isRunning()) return;
+
+    const QString path = QFileDialog::getOpenFileName(
+        this, "Compare with", QString(), "Intrinsics data (*.xml)");
+    if(path.isEmpty()) return;
 
-    for(QDockWidget* dw: m_dock_widgets) restoreDockWidget(dw);
+    ParseData current;
+    current.symbols    = p_symbols;
+    current.intrinsics = p_model->intrinsics();
+
+    p_compare_watcher->setFuture(QtConcurrent::run(
+        [path, current = std::move(current)]() mutable
+        {
+            TRACE_SCOPE("compareData");
+
+            Comparison ret;
+            try
+            {
+                QFile data_file(path);
+
+                // the loaded data goes first and keeps its symbol IDs
+                QVector<ParseData> versions{std::move(current),
+                                            parse_doc(&data_file)};
+                share_symbols(versions);
+
+                ret.version = versions[1].version.isEmpty() ?
+                                  QFileInfo(path).fileName() :
+                                  versions[1].version;
+                ret.symbols = versions[1].symbols;
+                ret.old     = std::move(versions[1].intrinsics);
+                ret.diff    = diff_intrinsics(ret.old, versions[0].intrinsics);
+            }
+            catch(const ParsingError& ex)
+            {
+                ret.error = error_text(ex);
+            }
+
+            return ret;
+        }));
+}
+
+void
+MainWindow::showChanges()
+{
+    const Comparison comparison = p_compare_watcher->result();
+
+    p_changes_list->clear();
+    p_changes_dock->show();
+    p_changes_dock->raise();
+
+    if(!comparison.error.isEmpty())
+    {
+        p_changes_dock->setWindowTitle("Changes");
+        p_changes_list->addItem("Failed to parse data: " + comparison.error);
+        return;
+    }
+
+    const IntrinsicsDiff& diff       = comparison.diff;
+    const Intrinsics&     intrinsics = p_model->intrinsics();
+
+    p_changes_dock->setWindowTitle(
+        QString("Changes since %1: %2 added, %3 removed, %4 changed")
+            .arg(comparison.version)
+            .arg(diff.added.count())
+            .arg(diff.removed.count())
+            .arg(diff.changed.count()));
+
+    for(const int n: diff.added)
+    {
+        auto* item = new QListWidgetItem("+ " + intrinsics[n].name);
+        item->setData(Qt::UserRole, n);
+        item->setToolTip(intrinsicID(intrinsics[n], *p_symbols));
+        p_changes_list->addItem(item);
+    }
+
+    for(const int n: diff.removed)
+    {
+        auto* item = new QListWidgetItem("- " + comparison.old[n].name);
+        item->setToolTip(
+            intrinsicID(comparison.old[n], *comparison.symbols));
+        p_changes_list->addItem(item);
+    }
+
+    for(const IntrinsicChange& change: diff.changed)
+    {
+        const Intrinsic& i    = intrinsics[change.to];
+        auto*            item = new QListWidgetItem(
+            QString("~ %1 (%2)")
+                .arg(i.name, change_fields(change.fields).join(", ")));
+        item->setData(Qt::UserRole, change.to);
+        item->setToolTip(intrinsicID(i, *p_symbols));
+        p_changes_list->addItem(item);
+    }
+}
+
+int
+MainWindow::maxLiveDocks() const
+{
+    return m_max_live_docks;
+}
+
+void
+MainWindow::setMaxLiveDocks(const int max_docks)
+{
+    m_max_live_docks = qMax(1, max_docks);
 }
 
 QBrush
@@ -468,23 +752,65 @@ MainWindow::selectParent(QTreeWidgetItem* child, int column)
 void
 MainWindow::connectSignals()
 {
-    auto slot = [&](auto...) { filter(); };
+    auto slot = [&](const char* trigger)
+    { return [this, trigger](auto...) { filter(trigger); }; };
 
-    QObject::connect(p_tech_tree, &QTreeWidget::itemChanged, slot);
-    QObject::connect(p_cat_list, &QListWidget::itemChanged, slot);
-    QObject::connect(p_search_edit, &QLineEdit::textChanged, slot);
-    QObject::connect(p_ret_combo, &QComboBox::currentTextChanged, slot);
+    QObject::connect(p_tech_tree, &QTreeWidget::itemChanged, slot("techs"));
+    QObject::connect(p_cat_list, &QListWidget::itemChanged, slot("categories"));
+    QObject::connect(p_search_edit, &QLineEdit::textChanged, slot("search"));
+    QObject::connect(
+        p_ret_combo, &QComboBox::currentTextChanged, slot("return"));
     QObject::connect(p_name_list,
-                     &QListWidget::itemClicked,
-                     [&](QListWidgetItem* item)
-                     { showIntrinsic(intrinsic(item)); });
+                     &QListView::clicked,
+                     [&](const QModelIndex& index)
+                     { showIntrinsic(p_model->position(index.row())); });
+
+    QObject::connect(p_name_list->verticalScrollBar(),
+                     &QScrollBar::valueChanged,
+                     this,
+                     &MainWindow::prefetchDetails);
+    QObject::connect(p_model,
+                     &QAbstractItemModel::modelReset,
+                     this,
+                     &MainWindow::prefetchDetails);
+}
+
+void
+MainWindow::prefetchDetails()
+{
+    const QRect       rect  = p_name_list->viewport()->rect();
+    const QModelIndex first = p_name_list->indexAt(rect.topLeft());
+    if(!first.isValid()) return;
+
+    const QModelIndex last   = p_name_list->indexAt(rect.bottomLeft());
+    const int         rows   = p_model->rowCount();
+    const int         top    = first.row();
+    const int         bottom = last.isValid() ? last.row() : rows - 1;
+    const int         page   = bottom - top + 1;
+
+    // the visible rows go first, then a page around them
+    QVector<int> positions;
+    positions.reserve(page * 3);
+    for(int row = top; row <= bottom; ++row)
+        positions.append(p_model->position(row));
+    for(int d = 1; d <= page; ++d)
+    {
+        if(bottom + d < rows) positions.append(p_model->position(bottom + d));
+        if(top - d >= 0) positions.append(p_model->position(top - d));
+    }
+
+    p_details_cache->prefetch(positions);
 }
 
 void
 MainWindow::initialFilter()
 {
-    if(!(searchText().isEmpty() && selectedRet() == "*" &&
-         selectedTechs().isEmpty() && selectedCPUIDs().isEmpty() &&
-         selectedCategories().isEmpty()))
-        filter();
+    TRACE_SCOPE("initialFilter");
+
+    // the model was filled before prefetching was connected to its resets,
+    // an unfiltered list prefetches once the window is laid out
+    if(!query().isEmpty())
+        filter("initial");
+    else
+        QTimer::singleShot(0, this, &MainWindow::prefetchDetails);
 }
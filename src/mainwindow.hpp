@@ -18,62 +18,143 @@
 
 #pragma once
 
+#include "details.hpp"
+#include "diff.hpp"
+#include "index.hpp"
+#include "metrics.hpp"
+#include "model.hpp"
 #include "parser.hpp"
 
 #include <QColor>
 #include <QComboBox>
 #include <QDockWidget>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
 #include <QHash>
 #include <QLineEdit>
+#include <QListView>
 #include <QListWidget>
+#include <QList>
 #include <QListWidgetItem>
 #include <QMainWindow>
+#include <QPlainTextEdit>
 #include <QSet>
 #include <QSplitter>
 #include <QStringList>
+#include <QTimer>
 #include <QTreeWidget>
 #include <QTreeWidgetItem>
 #include <QVector>
 
+#include <atomic>
+#include <memory>
 #include <utility>
 
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
 
-    QLineEdit*                   p_search_edit = new QLineEdit;
-    QComboBox*                   p_ret_combo   = new QComboBox;
-    QTreeWidget*                 p_tech_tree   = new QTreeWidget;
-    QListWidget*                 p_cat_list    = new QListWidget;
-    QListWidget*                 p_name_list   = new QListWidget;
-    QSplitter*                   p_left_split  = new QSplitter(Qt::Vertical);
-    QSplitter*                   p_top_split   = new QSplitter(Qt::Horizontal);
-    QVector<QListWidgetItem*>    m_intrinsics_widgets;
-    QVector<QListWidgetItem*>    m_category_widgets;
-    QVector<QTreeWidgetItem*>    m_tech_widgets;
-    QVector<QTreeWidgetItem*>    m_cpuid_widgets;
-    QHash<QString, Intrinsic>    m_intrinsics_map;
-    QHash<QString, QDockWidget*> m_dock_widgets;
-    QHash<QString, QColor>       m_colormap{
-              {"Other", Qt::gray}
+    QLineEdit*                         p_search_edit = new QLineEdit;
+    QComboBox*                         p_ret_combo   = new QComboBox;
+    QTreeWidget*                       p_tech_tree   = new QTreeWidget;
+    QListWidget*                       p_cat_list    = new QListWidget;
+    IntrinsicsView*                    p_name_list   = new IntrinsicsView;
+    IntrinsicsModel*                   p_model =
+        new IntrinsicsModel(this);
+    DetailsCache*                      p_details_cache =
+        new DetailsCache(this);
+    QSplitter*                         p_left_split =
+        new QSplitter(Qt::Vertical);
+    QSplitter*                         p_top_split =
+        new QSplitter(Qt::Horizontal);
+    QVector<QListWidgetItem*>          m_category_widgets;
+    QVector<QTreeWidgetItem*>          m_tech_widgets;
+    QVector<QTreeWidgetItem*>          m_cpuid_widgets;
+    std::shared_ptr<const Symbols>     p_symbols =
+        std::make_shared<Symbols>();
+    std::shared_ptr<const FilterIndex> p_index =
+        std::make_shared<FilterIndex>();
+    QTimer*                            p_filter_timer   = new QTimer(this);
+    QFutureWatcher<QVector<int>>*      p_filter_watcher =
+        new QFutureWatcher<QVector<int>>(this);
+    std::shared_ptr<std::atomic_bool>  p_filter_cancel;
+    bool                               m_filter_pending = false;
+    QElapsedTimer                      m_filter_clock;
+    const char*                        p_filter_trigger = nullptr;
+    Metrics                            m_metrics;
+    QDockWidget*                       p_metrics_dock =
+        new QDockWidget("Metrics");
+    QPlainTextEdit*                    p_metrics_text  = new QPlainTextEdit;
+    QTimer*                            p_metrics_timer = new QTimer(this);
+    QDockWidget*                       p_changes_dock =
+        new QDockWidget("Changes");
+    QListWidget*                       p_changes_list = new QListWidget;
+    QHash<QString, QDockWidget*>       m_dock_widgets;
+    QHash<QDockWidget*, int>           m_dock_positions;
+    QList<QDockWidget*>                m_live_docks;
+    QDockWidget*                       p_last_dock      = nullptr;
+    int                                m_max_live_docks = 16;
+    QHash<QString, QColor>             m_colormap{
+                                       {"Other", Qt::gray}
     };
 
+    // the loaded data against an older version, made on a worker
+    struct Comparison
+    {
+        QString                        error;
+        QString                        version;
+        std::shared_ptr<const Symbols> symbols;
+        Intrinsics                     old;
+        IntrinsicsDiff                 diff;
+    };
+
+    QFutureWatcher<Comparison>* p_compare_watcher =
+        new QFutureWatcher<Comparison>(this);
+
     QBrush
     techBrush(const QString& tech, const int alpha = 255) const;
 
+    Query
+    query() const;
+
+    // Filtering runs on a worker over the immutable index. Requests made
+    // in one event loop pass are coalesced, a request made while the worker
+    // runs cancels it and restarts it with the latest query. The time from
+    // the first request to the shown result goes to the histogram of the
+    // trigger of the last request.
+    void
+    filter(const char* trigger);
+
     void
-    filter();
+    startFilter();
 
     void
-    showIntrinsic(const Intrinsic& i);
+    filterFinished();
+
+    void
+    showIntrinsic(const int position);
+
+    // Every shown intrinsic keeps its dock and tab, but only the most
+    // recently activated docks hold details widgets. A dock evicted past the
+    // cap is rebuilt from the details cache once it is activated again.
+    void
+    activateDock(QDockWidget* dw);
+
+    IntrinsicDetails*
+    makeDetails(const int position) const;
 
-    const Intrinsic&
-    intrinsic(QListWidgetItem* item);
+    // position of the intrinsic with the ID or -1
+    int
+    findIntrinsic(const QString& iid) const;
 
   private slots:
     void
     selectParent(QTreeWidgetItem* child, int column);
 
+    // queues the details of the visible and neighbouring rows
+    void
+    prefetchDetails();
+
   public:
     MainWindow(QWidget* parent = nullptr);
 
@@ -93,7 +174,7 @@ class MainWindow : public QMainWindow
     fillRetCombo(const QStringList& rets);
 
     void
-    addIntrinsics(const Intrinsics&);
+    addIntrinsics(const Intrinsics&, std::shared_ptr<const Symbols>);
 
     QString
     searchText() const;
@@ -131,9 +212,28 @@ class MainWindow : public QMainWindow
     void
     showIntrinsics(const QStringList&);
 
+    int
+    maxLiveDocks() const;
+
+    void
+    setMaxLiveDocks(const int);
+
     std::pair<QByteArray, QByteArray>
     saveSplittersState() const;
 
     void
     restoreSplittersState(const QByteArray&, const QByteArray&);
+
+    // writes the latency histograms to the log
+    void
+    dumpMetrics() const;
+
+    // Asks for an older data file and lists the intrinsics added, removed
+    // and changed since it in the changes dock.
+    void
+    compareData();
+
+  private:
+    void
+    showChanges();
 };
@@ -0,0 +1,104 @@
+// -*- C++ -*-
+// metrics.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "metrics.hpp"
+
+#include <QTextStream>
+
+#include <algorithm>
+
+int
+Histogram::bucket(const qint64 usecs) noexcept
+{
+    const quint64 v   = static_cast<quint64>(qMax<qint64>(usecs, 1));
+    const int     e   = 63 - qCountLeadingZeroBits(v);
+    const int     sub = e >= 2 ? static_cast<int>((v >> (e - 2)) & 3) :
+                                 static_cast<int>(v & ((1u << e) - 1));
+
+    return qMin(e * sub_buckets + sub, buckets - 1);
+}
+
+qint64
+Histogram::bucketLimit(const int bucket) noexcept
+{
+    const int    e   = bucket / sub_buckets;
+    const qint64 sub = bucket % sub_buckets;
+
+    if(e < 2) return (qint64(1) << e) + sub;
+
+    return ((sub_buckets + sub + 1) << (e - 2)) - 1;
+}
+
+void
+Histogram::record(const qint64 nsecs) noexcept
+{
+    const qint64 usecs = nsecs / 1000;
+
+    ++m_counts[bucket(usecs)];
+    ++m_count;
+    m_sum += usecs;
+    m_max = qMax(m_max, usecs);
+    if(usecs > frame_budget) ++m_over_budget;
+}
+
+double
+Histogram::mean() const noexcept
+{
+    return m_count ? static_cast<double>(m_sum) / m_count : 0.0;
+}
+
+qint64
+Histogram::percentile(const double p) const noexcept
+{
+    const quint64 rank =
+        static_cast<quint64>(std::max(1.0, p / 100.0 * m_count + 0.5));
+
+    quint64 seen = 0;
+    for(int b = 0; b < buckets; ++b)
+        if((seen += m_counts[b]) >= rank) return qMin(bucketLimit(b), m_max);
+
+    return m_max;
+}
+
+QString
+Metrics::report() const
+{
+    QString     ret;
+    QTextStream out(&ret);
+
+    out << qSetFieldWidth(20) << Qt::left << "us" << qSetFieldWidth(9)
+        << Qt::right << "count"
+        << "mean"
+        << "p50"
+        << "p90"
+        << "p99"
+        << "max"
+        << ">16ms" << qSetFieldWidth(0) << '\n';
+
+    for(auto it = m_histograms.cbegin(); it != m_histograms.cend(); ++it)
+    {
+        const Histogram& h = it.value();
+        out << qSetFieldWidth(20) << Qt::left << it.key() << qSetFieldWidth(9)
+            << Qt::right << h.count() << QString::number(h.mean(), 'f', 0)
+            << h.percentile(50) << h.percentile(90) << h.percentile(99)
+            << h.max() << h.overBudget() << qSetFieldWidth(0) << '\n';
+    }
+
+    out.flush();
+    return ret;
+}
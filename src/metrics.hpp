@@ -0,0 +1,103 @@
+// -*- C++ -*-
+// metrics.hpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <QMap>
+#include <QString>
+#include <QtGlobal>
+
+#include <array>
+
+// Latency histogram with four buckets per power of two microseconds, so a
+// recording is a couple of shifts and an increment and percentiles are
+// within a quarter of the value.
+class Histogram
+{
+    static constexpr int sub_buckets = 4;
+    static constexpr int buckets     = 40 * sub_buckets;
+
+    std::array<quint32, buckets> m_counts{};
+    quint64                      m_count       = 0;
+    quint64                      m_over_budget = 0;
+    qint64                       m_sum         = 0;
+    qint64                       m_max         = 0;
+
+    static int
+    bucket(qint64 usecs) noexcept;
+
+    static qint64
+    bucketLimit(int bucket) noexcept;
+
+  public:
+    // a frame at 60 Hz
+    static constexpr qint64 frame_budget = 16000;
+
+    void
+    record(qint64 nsecs) noexcept;
+
+    quint64
+    count() const noexcept
+    {
+        return m_count;
+    }
+
+    // recordings over the frame budget
+    quint64
+    overBudget() const noexcept
+    {
+        return m_over_budget;
+    }
+
+    // in microseconds
+    double
+    mean() const noexcept;
+
+    qint64
+    max() const noexcept
+    {
+        return m_max;
+    }
+
+    // upper limit of the bucket holding the percentile, in microseconds
+    qint64
+    percentile(double p) const noexcept;
+};
+
+// Histograms by the name of what they time
+class Metrics
+{
+    QMap<QString, Histogram> m_histograms;
+
+  public:
+    void
+    record(const QString& name, qint64 nsecs)
+    {
+        m_histograms[name].record(nsecs);
+    }
+
+    bool
+    isEmpty() const noexcept
+    {
+        return m_histograms.isEmpty();
+    }
+
+    // table of the counts, percentiles and frame budget overruns
+    QString
+    report() const;
+};
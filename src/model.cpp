@@ -0,0 +1,103 @@
+// -*- C++ -*-
+// model.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "model.hpp"
+#include "render.hpp"
+
+#include <QElapsedTimer>
+
+#include <numeric>
+#include <utility>
+
+IntrinsicsModel::IntrinsicsModel(QObject* parent) : QAbstractListModel(parent)
+{
+}
+
+void
+IntrinsicsModel::setIntrinsics(const Intrinsics&              intrinsics,
+                               std::shared_ptr<const Symbols> symbols,
+                               TechBrush                      tech_brush)
+{
+    beginResetModel();
+
+    m_intrinsics = intrinsics;
+    p_symbols    = std::move(symbols);
+    m_tech_brush = std::move(tech_brush);
+    m_brushes    = QVector<QBrush>(p_symbols->techs.count(), Qt::NoBrush);
+
+    m_rows.resize(m_intrinsics.count());
+    std::iota(m_rows.begin(), m_rows.end(), 0);
+
+    endResetModel();
+}
+
+void
+IntrinsicsModel::setShown(QVector<int> rows)
+{
+    if(rows == m_rows) return;
+
+    beginResetModel();
+    m_rows.swap(rows);
+    endResetModel();
+}
+
+const Intrinsic&
+IntrinsicsModel::intrinsic(const QModelIndex& index) const
+{
+    return m_intrinsics[m_rows[index.row()]];
+}
+
+int
+IntrinsicsModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_rows.count();
+}
+
+QVariant
+IntrinsicsModel::data(const QModelIndex& index, int role) const
+{
+    if(!index.isValid() || index.row() >= m_rows.count()) return {};
+
+    const Intrinsic& i = intrinsic(index);
+
+    switch(role)
+    {
+    case Qt::DisplayRole: return i.name;
+    case Qt::ToolTipRole: return signature(i, *p_symbols);
+    case Qt::BackgroundRole:
+    {
+        QBrush& brush = m_brushes[i.tech];
+        if(brush.style() == Qt::NoBrush)
+            brush = m_tech_brush(p_symbols->techs[i.tech]);
+        return brush;
+    }
+    case position_role: return m_rows[index.row()];
+    default: return {};
+    }
+}
+
+void
+IntrinsicsView::paintEvent(QPaintEvent* event)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QListView::paintEvent(event);
+
+    emit painted(timer.nsecsElapsed());
+}
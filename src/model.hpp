@@ -0,0 +1,109 @@
+// -*- C++ -*-
+// model.hpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "parser.hpp"
+
+#include <QAbstractListModel>
+#include <QBrush>
+#include <QListView>
+#include <QModelIndex>
+#include <QPaintEvent>
+#include <QVariant>
+#include <QVector>
+
+#include <functional>
+#include <memory>
+
+// Names of the shown intrinsics. Rows map to positions in the intrinsics
+// vector, tooltips and backgrounds are made when the view asks for them.
+class IntrinsicsModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+    using TechBrush = std::function<QBrush(const QString&)>;
+
+    Intrinsics                     m_intrinsics;
+    std::shared_ptr<const Symbols> p_symbols = std::make_shared<Symbols>();
+    QVector<int>                   m_rows;
+    TechBrush                      m_tech_brush;
+    mutable QVector<QBrush>        m_brushes;
+
+  public:
+    // position of the intrinsic in the intrinsics vector
+    static constexpr int position_role = Qt::UserRole;
+
+    explicit IntrinsicsModel(QObject* parent = nullptr);
+
+    // shows all the intrinsics
+    void
+    setIntrinsics(const Intrinsics&              intrinsics,
+                  std::shared_ptr<const Symbols> symbols,
+                  TechBrush                      tech_brush);
+
+    // shows the intrinsics at the positions in the order given
+    void
+    setShown(QVector<int> rows);
+
+    const Intrinsics&
+    intrinsics() const noexcept
+    {
+        return m_intrinsics;
+    }
+
+    const Intrinsic&
+    intrinsic(const QModelIndex& index) const;
+
+    // position in the intrinsics vector of the row
+    int
+    position(const int row) const noexcept
+    {
+        return m_rows[row];
+    }
+
+    // row of the intrinsic at the position, -1 if it isn't shown
+    int
+    row(const int position) const noexcept
+    {
+        return int(m_rows.indexOf(position));
+    }
+
+    int
+    rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+    QVariant
+    data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+};
+
+// List of the names telling how long its paints take
+class IntrinsicsView : public QListView
+{
+    Q_OBJECT
+
+  protected:
+    void
+    paintEvent(QPaintEvent* event) override;
+
+  public:
+    using QListView::QListView;
+
+  signals:
+    void
+    painted(qint64 nsecs);
+};
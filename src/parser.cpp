@@ -17,9 +17,24 @@
 //    along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "parser.hpp"
-
-#include <QDomDocument>
-
+#include "snapshot.hpp"
+#include "trace.hpp"
+
+#include <QFuture>
+#include <QIODevice>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QXmlStreamAttributes>
+#include <QXmlStreamReader>
+#include <QtConcurrent>
+
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string_view>
 #include <utility>
 
 static const inline QStringList order = {
@@ -29,26 +44,103 @@ static const inline QStringList order = {
     "AVX-512", "AMX Family", "AMX",    "KNC",        "SVML",
     "Other"};
 
+namespace
+{
 Var
-parse_var(const QDomNode& node)
+parse_var(const QXmlStreamAttributes& attrs)
 {
-    const QDomNamedNodeMap attrs = node.attributes();
-    return Var{attrs.namedItem("varname").nodeValue(),
-               attrs.namedItem("type").nodeValue()};
+    return Var{attrs.value("varname").toString(),
+               attrs.value("type").toString()};
 }
 
 Instruction
-parse_instruction(const QDomNode& node)
+parse_instruction(const QXmlStreamAttributes& attrs)
 {
-    const QDomNamedNodeMap attrs = node.attributes();
-    return Instruction{attrs.namedItem("name").nodeValue(),
-                       attrs.namedItem("form").nodeValue(),
-                       attrs.namedItem("xed").nodeValue()};
+    return Instruction{attrs.value("name").toString(),
+                       attrs.value("form").toString(),
+                       attrs.value("xed").toString()};
 }
 
+// same as QDomElement::text(): the text of all nested elements is included
+QString
+element_text(QXmlStreamReader& xml)
+{
+    return xml.readElementText(QXmlStreamReader::IncludeChildElements);
+}
+
+// Locates the raw contents of text elements in the mapped data. The reader
+// visits elements in document order, so the search never goes back.
+class SpanFinder
+{
+    std::shared_ptr<const TextStore> p_store;
+    std::string_view                 m_data;
+    std::size_t                      m_pos = 0;
+
+  public:
+    explicit SpanFinder(std::shared_ptr<const TextStore> store,
+                        const std::size_t                pos = 0) :
+        p_store(std::move(store)),
+        m_data(p_store->data(), static_cast<std::size_t>(p_store->size())),
+        m_pos(pos)
+    {
+    }
+
+    // Expects the reader to stand on the <tag> start element.
+    LazyText
+    element(QXmlStreamReader& xml, const std::string_view tag)
+    {
+        xml.skipCurrentElement();
+
+        std::size_t open = m_pos;
+        while(true)
+        {
+            open = m_data.find(tag, open);
+            if(open == std::string_view::npos || open == 0) return {};
+
+            const std::size_t after = open + tag.size();
+            if(m_data[open - 1] == '<' && after < m_data.size() &&
+               (m_data[after] == '>' || m_data[after] == '/' ||
+                std::isspace(static_cast<unsigned char>(m_data[after]))))
+                break;
+
+            open = after;
+        }
+
+        const std::size_t begin = m_data.find('>', open) + 1;
+        if(begin == 0) return {};
+
+        // <tag/>
+        if(m_data[begin - 2] == '/')
+        {
+            m_pos = begin;
+            return {};
+        }
+
+        std::size_t end = begin;
+        while(true)
+        {
+            end = m_data.find(tag, end);
+            if(end == std::string_view::npos) return {};
+            if(m_data[end - 1] == '/' && m_data[end - 2] == '<') break;
+            end += tag.size();
+        }
+
+        // a text can't decode to more than a QString holds
+        const std::size_t size = end - 2 - begin;
+        if(size >= std::size_t(std::numeric_limits<int>::max()))
+            throw ParsingError{ParsingError::NOT_IIDATA};
+
+        m_pos = end + tag.size();
+        return LazyText(p_store,
+                        static_cast<qint64>(begin),
+                        static_cast<quint32>(size),
+                        true);
+    }
+};
+
 template <typename Op, std::size_t N, typename... Rest>
 void
-find_match(const QString& name,
+find_match(const QStringRef& name,
            const char (&match)[N],
            Op&& op,
            Rest&&... rest) noexcept
@@ -75,73 +167,67 @@ add_family(QString& name, const char (&match)[N], Rest&&... rest)
         return name;
 }
 
+// Expects the reader to stand on the <intrinsic> start element and leaves it
+// on the matching end element.
 Intrinsic
-parse_intrinsic(const QDomNode& node,
-                QSet<QString>&  techs,
-                QSet<QString>&  cpuids,
-                QSet<QString>&  categories,
-                QSet<QString>&  rets)
+parse_intrinsic(QXmlStreamReader& xml, SpanFinder& spans, Symbols& symbols)
 {
+    TRACE_SCOPE("parse_intrinsic");
+
     Intrinsic ret;
 
-    const QDomNamedNodeMap attrs = node.attributes();
-    ret.name                     = attrs.namedItem("name").nodeValue();
+    const QXmlStreamAttributes attrs = xml.attributes();
+    ret.name                         = attrs.value("name").toString();
 
-    QString tech = attrs.namedItem("tech").nodeValue();
+    QString tech = attrs.value("tech").toString();
 
     if(tech.endsWith("_ALL"))
         tech.replace("_ALL", " Family");
     else
         add_family(tech, "AVX-512", "AMX");
 
-    ret.tech = tech;
-    techs.insert(tech);
-
-    const QDomNodeList fields = node.childNodes();
+    ret.tech = symbols.techs.intern(tech);
 
-    for(int i = 0; i < fields.count(); ++i)
+    while(xml.readNextStartElement())
     {
-        const QDomNode field = fields.at(i);
-        const QString  name  = field.nodeName();
-        QString        text  = field.toElement().text();
-
-        const auto set_text = [&](auto& member)
-        { return [&]() { member = text; }; };
+        const auto set_symbol = [&](SymbolID& member, SymbolTable& table)
+        { return [&]() { member = table.intern(element_text(xml)); }; };
 
         find_match(
-            name,
+            xml.name(),
             "category",
-            [&]()
-            {
-                ret.category = text;
-                categories.insert(text);
-            },
+            set_symbol(ret.category, symbols.categories),
             "CPUID",
             [&]()
             {
+                QString text = element_text(xml);
                 text.replace("AVX512", "AVX-512");
-                ret.cpuids.insert(text);
-                cpuids.insert(text);
+                const SymbolID id = symbols.cpuids.intern(text);
+                if(id >= max_cpuids)
+                    throw ParsingError{ParsingError::TOO_MANY_CPUIDS};
+                ret.cpuids.set(id);
             },
             "return",
             [&]()
             {
-                QString node_value =
-                    field.attributes().namedItem("type").nodeValue();
+                QString node_value = xml.attributes().value("type").toString();
                 if(node_value == "void*") node_value = "void *";
-                ret.ret_type = node_value;
-                rets.insert(node_value);
+                ret.ret_type = symbols.rets.intern(node_value);
             },
             "parameter",
-            [&]() { ret.parms.append(parse_var(field)); },
+            [&]() { ret.parms.append(parse_var(xml.attributes())); },
             "description",
-            set_text(ret.description),
+            [&]() { ret.description = spans.element(xml, "description"); },
             "operation",
-            set_text(ret.operation),
+            [&]() { ret.operation = spans.element(xml, "operation"); },
             "instruction",
-            [&]() { ret.instructions.append(parse_instruction(field)); },
+            [&]()
+            { ret.instructions.append(parse_instruction(xml.attributes())); },
             "header",
-            set_text(ret.header));
+            set_symbol(ret.header, symbols.headers));
+
+        // attribute-only and unknown elements are still open
+        if(xml.isStartElement()) xml.skipCurrentElement();
     }
 
     if(!ret.parms.empty()) ret.parms.shrink_to_fit();
@@ -150,6 +236,225 @@ parse_intrinsic(const QDomNode& node,
     return ret;
 }
 
+// Parses the intrinsics the reader's current element contains
+void
+parse_intrinsics(QXmlStreamReader& xml,
+                 SpanFinder&       spans,
+                 Intrinsics&       intrinsics,
+                 Symbols&          symbols)
+{
+    TRACE_SCOPE("parse_intrinsics");
+
+    while(xml.readNextStartElement())
+    {
+        if(xml.name() == QLatin1String("intrinsic"))
+            intrinsics.append(parse_intrinsic(xml, spans, symbols));
+        else
+            xml.skipCurrentElement();
+    }
+}
+
+// Offset of the first <intrinsic> start tag at or after pos
+std::size_t
+next_intrinsic(const std::string_view data, std::size_t pos) noexcept
+{
+    static constexpr std::string_view tag = "<intrinsic";
+
+    while((pos = data.find(tag, pos)) != std::string_view::npos)
+    {
+        const std::size_t after = pos + tag.size();
+        if(after < data.size() &&
+           (data[after] == '>' ||
+            std::isspace(static_cast<unsigned char>(data[after]))))
+            return pos;
+        pos = after;
+    }
+
+    return pos;
+}
+
+// A span of the mapped data, wrapped into a root element unless it is the
+// whole document, so a run of <intrinsic> elements reads as a document of
+// its own. Nothing is copied except into the reader's block buffer, and
+// positions are 64 bit, so files past 2 GiB read as any other.
+class ChunkDevice : public QIODevice
+{
+    std::string_view m_parts[3];
+
+  protected:
+    qint64
+    readData(char* data, qint64 maxlen) override
+    {
+        qint64 pos  = this->pos();
+        qint64 done = 0;
+
+        for(const std::string_view part: m_parts)
+        {
+            const qint64 part_size = static_cast<qint64>(part.size());
+            if(pos >= part_size)
+            {
+                pos -= part_size;
+                continue;
+            }
+
+            const qint64 n = qMin(maxlen - done, part_size - pos);
+            std::memcpy(data + done, part.data() + pos, n);
+            done += n;
+            pos = 0;
+
+            if(done == maxlen) break;
+        }
+
+        return done;
+    }
+
+    qint64
+    writeData(const char*, qint64) override
+    {
+        return -1;
+    }
+
+  public:
+    explicit ChunkDevice(const std::string_view chunk,
+                         const bool             wrapped = true) :
+        m_parts{wrapped ? "<chunk>" : "", chunk, wrapped ? "</chunk>" : ""}
+    {
+        open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    }
+
+    qint64
+    size() const override
+    {
+        qint64 ret = 0;
+        for(const std::string_view part: m_parts)
+            ret += static_cast<qint64>(part.size());
+        return ret;
+    }
+};
+
+// smaller files are not worth spinning up the threads
+constexpr qint64 parallel_min_size = 1 << 20;
+
+struct ParsedChunk
+{
+    Intrinsics                  intrinsics;
+    Symbols                     symbols;
+    std::optional<ParsingError> error;
+};
+
+ParsedChunk
+parse_chunk(const std::shared_ptr<const TextStore>& store,
+            const std::size_t                       begin,
+            const std::size_t                       end)
+{
+    TRACE_SCOPE("parse_chunk");
+
+    ChunkDevice device(std::string_view(store->data() + begin, end - begin));
+    QXmlStreamReader xml(&device);
+    SpanFinder       spans(store, begin);
+
+    ParsedChunk ret;
+    ret.intrinsics.reserve(static_cast<int>((end - begin) / 1024));
+
+    try
+    {
+        xml.readNextStartElement();
+        parse_intrinsics(xml, spans, ret.intrinsics, ret.symbols);
+        if(xml.hasError()) ret.error = ParsingError{ParsingError::NOT_IIDATA};
+    }
+    catch(const ParsingError& ex)
+    {
+        ret.error = ex;
+    }
+
+    return ret;
+}
+} // namespace
+
+// Moves chunk local IDs to the merged tables
+void
+remap_intrinsic(Intrinsic& i, const Symbols::Remap& remap) noexcept
+{
+    i.tech     = remap.techs[i.tech];
+    i.category = remap.categories[i.category];
+    i.ret_type = remap.rets[i.ret_type];
+    i.header   = remap.headers[i.header];
+
+    CpuidMask cpuids;
+    for(int id = 0; id < remap.cpuids.count(); ++id)
+        if(i.cpuids.test(static_cast<std::size_t>(id)))
+            cpuids.set(remap.cpuids[id]);
+    i.cpuids = cpuids;
+}
+
+namespace
+{
+// Splits the intrinsics into chunks and parses them on a thread pool.
+// Chunks are merged in document order, so the result, symbol IDs included,
+// is the same as that of the serial pass. Returns false if there are no
+// intrinsics to split.
+bool
+parse_parallel(const std::shared_ptr<const TextStore>& store,
+               const int                               threads,
+               Intrinsics&                             intrinsics,
+               Symbols&                                symbols)
+{
+    TRACE_SCOPE("parse_parallel");
+
+    const std::string_view data(store->data(),
+                                static_cast<std::size_t>(store->size()));
+
+    static constexpr std::string_view end_tag = "</intrinsic>";
+
+    const std::size_t first = next_intrinsic(data, 0);
+    std::size_t       last  = data.rfind(end_tag);
+    if(first == std::string_view::npos || last == std::string_view::npos ||
+       last < first)
+        return false;
+    last += end_tag.size();
+
+    // a few chunks per thread even out the load
+    const std::size_t    num_chunks = static_cast<std::size_t>(threads) * 4;
+    QVector<std::size_t> bounds{first};
+    for(std::size_t c = 1; c < num_chunks; ++c)
+    {
+        const std::size_t bound =
+            qMin(next_intrinsic(data, first + (last - first) * c / num_chunks),
+                 last);
+        if(bound > bounds.back()) bounds.append(bound);
+    }
+    if(last > bounds.back()) bounds.append(last);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+
+    QVector<QFuture<ParsedChunk>> futures;
+    futures.reserve(bounds.count() - 1);
+    for(int c = 1; c < bounds.count(); ++c)
+        futures.append(QtConcurrent::run(
+            &pool, parse_chunk, store, bounds[c - 1], bounds[c]));
+
+    for(QFuture<ParsedChunk>& future: futures)
+    {
+        ParsedChunk chunk = future.result();
+        if(chunk.error) throw *chunk.error;
+
+        TRACE_SCOPE("merge_chunk");
+
+        const Symbols::Remap remap = symbols.merge(chunk.symbols);
+        if(symbols.cpuids.count() > max_cpuids)
+            throw ParsingError{ParsingError::TOO_MANY_CPUIDS};
+
+        for(Intrinsic& i: chunk.intrinsics)
+        {
+            remap_intrinsic(i, remap);
+            intrinsics.append(std::move(i));
+        }
+    }
+
+    return true;
+}
+
 template <std::size_t N, typename... Rest>
 QString
 start_super(const QString& cpuid,
@@ -163,6 +468,7 @@ start_super(const QString& cpuid,
     else
         return "";
 }
+} // namespace
 
 QString
 cpuid_super(const QString& cpuid) noexcept
@@ -180,69 +486,84 @@ cpuid_super(const QString& cpuid) noexcept
     return map.value(cpuid, "Other");
 }
 
+namespace
+{
 ParseData
-parse_doc(QFile* data_file)
+parse_xml(const std::shared_ptr<const TextStore>& store, const int threads)
 {
-    QDomDocument data_doc;
-    if(data_doc.setContent(data_file))
-    {
-        const QDomElement      root       = data_doc.documentElement();
-        const QDomNamedNodeMap root_attrs = root.attributes();
+    TRACE_SCOPE("parse_xml");
 
-        const QDomNode date_node    = root_attrs.namedItem("date");
-        const QDomNode version_node = root_attrs.namedItem("version");
+    // The reader pulls the mapped data in small blocks. Descriptions and
+    // operations are not decoded, they keep the spans of the mapping
+    // instead.
+    const std::string_view data(store->data(),
+                                static_cast<std::size_t>(store->size()));
+    ChunkDevice            device(data, false);
 
-        if(date_node.isNull() || version_node.isNull())
-            throw ParsingError{ParsingError::NOT_IIDATA};
+    QXmlStreamReader xml(&device);
+    SpanFinder       spans(store);
+
+    if(!xml.readNextStartElement())
+        throw ParsingError{ParsingError::NOT_IIDATA};
+
+    const QXmlStreamAttributes root_attrs = xml.attributes();
 
-        const QDomNodeList xml_intrinsics = root.childNodes();
+    if(!root_attrs.hasAttribute("date") || !root_attrs.hasAttribute("version"))
+        throw ParsingError{ParsingError::NOT_IIDATA};
 
-        ParseData                     ret;
-        QHash<QString, QSet<QString>> techmap;
-        QSet<QString>                 categories;
-        QSet<QString>                 rets;
+    ParseData                     ret;
+    QHash<QString, QSet<QString>> techmap;
+    Symbols                       symbols;
 
+    ret.version = root_attrs.value("version").toString();
+    ret.date    = root_attrs.value("date").toString();
+
+    {
+        const bool parallel =
+            threads > 1 && store->size() >= parallel_min_size &&
+            parse_parallel(store, threads, ret.intrinsics, symbols);
+
+        if(!parallel)
         {
-            QSet<QString> techs;
-            QSet<QString> cpuids;
-
-            ret.intrinsics.reserve(xml_intrinsics.count());
-            for(int i = 0; i < xml_intrinsics.count(); ++i)
-                ret.intrinsics.append(parse_intrinsic(xml_intrinsics.at(i),
-                                                      techs,
-                                                      cpuids,
-                                                      categories,
-                                                      rets));
-
-            for(const QString& cpuid: cpuids)
-            {
-                QString super = cpuid_super(cpuid);
-                add_family(super, "SSE", "AVX", "AVX-512", "AMX");
-                if(!techmap.contains(super))
-                    techmap.insert(super, {cpuid});
-                else
-                    techmap[super].insert(cpuid);
-            }
+            // an intrinsic record takes about a kilobyte of XML
+            ret.intrinsics.reserve(static_cast<int>(store->size() / 1024));
+            parse_intrinsics(xml, spans, ret.intrinsics, symbols);
 
-            for(const QString& t: techs)
-                if(!techmap.contains(t)) techmap.insert(t, {});
+            if(xml.hasError()) throw ParsingError{ParsingError::NOT_IIDATA};
         }
 
-        const auto cmp = [](const QString& lhs, const QString& rhs) noexcept
+        for(const QString& cpuid: symbols.cpuids.names())
         {
-            const int  lhs_idx = order.indexOf(lhs);
-            const int  rhs_idx = order.indexOf(rhs);
-            const bool lhs_ord = lhs_idx != -1;
-            const bool rhs_ord = rhs_idx != -1;
-            if(lhs_ord && rhs_ord)
-                return lhs_idx < rhs_idx;
-            else if(lhs_ord)
-                return true;
-            else if(rhs_ord)
-                return false;
+            QString super = cpuid_super(cpuid);
+            add_family(super, "SSE", "AVX", "AVX-512", "AMX");
+            if(!techmap.contains(super))
+                techmap.insert(super, {cpuid});
             else
-                return lhs < rhs;
-        };
+                techmap[super].insert(cpuid);
+        }
+
+        for(const QString& t: symbols.techs.names())
+            if(!t.isEmpty() && !techmap.contains(t)) techmap.insert(t, {});
+    }
+
+    const auto cmp = [](const QString& lhs, const QString& rhs) noexcept
+    {
+        const int  lhs_idx = order.indexOf(lhs);
+        const int  rhs_idx = order.indexOf(rhs);
+        const bool lhs_ord = lhs_idx != -1;
+        const bool rhs_ord = rhs_idx != -1;
+        if(lhs_ord && rhs_ord)
+            return lhs_idx < rhs_idx;
+        else if(lhs_ord)
+            return true;
+        else if(rhs_ord)
+            return false;
+        else
+            return lhs < rhs;
+    };
+
+    {
+        TRACE_SCOPE("technologies");
 
         // fill up technologies
         ret.technologies.reserve(techmap.count());
@@ -265,23 +586,109 @@ parse_doc(QFile* data_file)
                   ret.technologies.end(),
                   [&](const Tech& lhs, const Tech& rhs)
                   { return cmp(lhs.family, rhs.family); });
+    }
 
-        // fill up categories
-        ret.categories.reserve(categories.count());
-        ret.categories.append(categories.values());
-        ret.categories.sort();
+    // fill up categories
+    ret.categories.reserve(symbols.categories.count());
+    for(const QString& c: symbols.categories.names())
+        if(!c.isEmpty()) ret.categories.append(c);
+    ret.categories.sort();
 
-        // fill up return parameters
-        ret.rets.reserve(rets.count() + 1);
-        ret.rets.append("*");
-        ret.rets.append(rets.values());
-        ret.rets.sort();
+    // fill up return parameters
+    ret.rets.reserve(symbols.rets.count() + 1);
+    ret.rets.append("*");
+    for(const QString& r: symbols.rets.names())
+        if(!r.isEmpty()) ret.rets.append(r);
+    ret.rets.sort();
 
-        ret.version = version_node.nodeValue();
-        ret.date    = date_node.nodeValue();
+    ret.symbols = std::make_shared<const Symbols>(std::move(symbols));
 
-        return ret;
+    return ret;
+}
+} // namespace
+
+Intrinsic
+parse_intrinsic(const QByteArray& element, Symbols& symbols)
+{
+    const auto             store = std::make_shared<const TextStore>(element);
+    const std::string_view data(store->data(),
+                                static_cast<std::size_t>(store->size()));
+    ChunkDevice            device(data, false);
+    QXmlStreamReader       xml(&device);
+    SpanFinder             spans(store);
+
+    if(!xml.readNextStartElement() ||
+       xml.name() != QLatin1String("intrinsic"))
+        throw ParsingError{ParsingError::NOT_IIDATA};
+
+    Intrinsic ret = parse_intrinsic(xml, spans, symbols);
+    if(xml.hasError()) throw ParsingError{ParsingError::NOT_IIDATA};
+
+    return ret;
+}
+
+ParseData
+parse_doc(QFile* data_file, const ParseOptions& options)
+{
+    TRACE_SCOPE("parse_doc");
+
+    const QString data_path = data_file->fileName();
+    const auto    store     = std::make_shared<const TextStore>(data_path);
+    if(!store->isValid()) throw ParsingError{};
+
+    const int threads =
+        options.threads > 0 ? options.threads : QThread::idealThreadCount();
+
+    if(options.snapshot_dir.isEmpty()) return parse_xml(store, threads);
+
+    const QString     snapshot = snapshot_path(options.snapshot_dir, data_path);
+    const SnapshotKey key      = snapshot_key(data_path, *store);
+
+    if(std::optional<ParseData> data = load_snapshot(snapshot, key))
+        return std::move(*data);
+
+    ParseData ret = parse_xml(store, threads);
+    if(!save_snapshot(snapshot, key, ret))
+        qWarning("Could not write data snapshot %s", qUtf8Printable(snapshot));
+
+    return ret;
+}
+
+QString
+error_text(const ParsingError& error)
+{
+    switch(error.reason)
+    {
+    case ParsingError::NOT_OPEN: return "Could not open file.";
+    case ParsingError::NOT_IIDATA: return "Incorrect data format.";
+    case ParsingError::TOO_MANY_CPUIDS:
+        return QString("More than %1 distinct CPUID flags.").arg(max_cpuids);
     }
-    else
-        throw ParsingError{};
+
+    return {};
+}
+
+QString
+intrinsicID(const Intrinsic& i, const Symbols& symbols)
+{
+    static const QString id_template("%1 (%2: %3)");
+
+    QStringList cpuids = symbols.cpuidNames(i.cpuids);
+    cpuids.sort();
+
+    return id_template.arg(i.name, symbols.techs[i.tech], cpuids.join('+'));
+}
+
+QString
+normalIntrinsicID(const QString& iid)
+{
+    // the CPUIDs are between the last ": " and the closing parenthesis
+    const int colon = iid.lastIndexOf(": ");
+    if(colon == -1 || !iid.endsWith(')')) return iid;
+
+    const int   begin  = colon + 2;
+    QStringList cpuids = iid.mid(begin, iid.size() - begin - 1).split('+');
+    cpuids.sort();
+
+    return iid.left(begin) + cpuids.join('+') + ')';
 }
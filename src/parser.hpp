@@ -18,12 +18,16 @@
 
 #pragma once
 
+#include "symbols.hpp"
+#include "textstore.hpp"
+
 #include <QFile>
-#include <QSet>
 #include <QString>
 #include <QStringList>
 #include <QVector>
 
+#include <memory>
+
 struct Var
 {
     QString name;
@@ -37,18 +41,20 @@ struct Instruction
     QString xed;
 };
 
+// Tech, category, return type and header are IDs in the matching tables
+// of Symbols, CPUIDs are a mask of IDs in the cpuids table.
 struct Intrinsic
 {
     QString              name;
-    QString              tech;
-    QString              category;
-    QSet<QString>        cpuids;
-    QString              ret_type;
+    SymbolID             tech     = 0;
+    SymbolID             category = 0;
+    CpuidMask            cpuids;
+    SymbolID             ret_type = 0;
     QVector<Var>         parms;
-    QString              description;
-    QString              operation;
+    LazyText             description;
+    LazyText             operation;
     QVector<Instruction> instructions;
-    QString              header;
+    SymbolID             header = 0;
 };
 
 struct ParsingError
@@ -56,7 +62,8 @@ struct ParsingError
     enum
     {
         NOT_OPEN,
-        NOT_IIDATA
+        NOT_IIDATA,
+        TOO_MANY_CPUIDS
     } reason = NOT_OPEN;
 };
 
@@ -70,13 +77,51 @@ using Intrinsics = QVector<Intrinsic>;
 
 struct ParseData
 {
-    QString       version;
-    QString       date;
-    Intrinsics    intrinsics;
-    QVector<Tech> technologies;
-    QStringList   categories;
-    QStringList   rets;
+    QString                        version;
+    QString                        date;
+    std::shared_ptr<const Symbols> symbols;
+    Intrinsics                     intrinsics;
+    QVector<Tech>                  technologies;
+    QStringList                    categories;
+    QStringList                    rets;
+};
+
+struct ParseOptions
+{
+    // where to keep the binary snapshot of the parsed data, none if empty
+    QString snapshot_dir;
+
+    // parser threads, one parses serially, zero picks the core count
+    int threads = 0;
 };
 
 ParseData
-parse_doc(QFile* data_file);
+parse_doc(QFile* data_file, const ParseOptions& options = {});
+
+// Parses the <intrinsic> element the bytes hold, interning its symbols.
+// The record parser on its own, for benchmarks. Throws ParsingError.
+Intrinsic
+parse_intrinsic(const QByteArray& element, Symbols& symbols);
+
+// technology family of the CPUID flag, "Other" if it has none
+QString
+cpuid_super(const QString& cpuid) noexcept;
+
+// human readable reason of the error
+QString
+error_text(const ParsingError& error);
+
+// Identity of an intrinsic: name, tech and CPUIDs. The CPUIDs are sorted
+// by name, so the ID doesn't depend on the order of the symbol tables and
+// holds across versions of the data and of the program.
+QString
+intrinsicID(const Intrinsic& i, const Symbols& symbols);
+
+// The ID with its CPUIDs sorted, as intrinsicID has them. IDs saved by
+// versions listing them in another order match again.
+QString
+normalIntrinsicID(const QString& iid);
+
+// moves the IDs of the intrinsic to the tables the remap leads to
+void
+remap_intrinsic(Intrinsic& i, const Symbols::Remap& remap) noexcept;
@@ -0,0 +1,115 @@
+// -*- C++ -*-
+// query.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "query.hpp"
+
+#include <QStringList>
+
+#include <cstring>
+
+namespace
+{
+// whitespace separated tokens, quotes and parentheses keep the spaces
+// between them
+QStringList
+tokens(const QString& text)
+{
+    QStringList ret;
+    QString     token;
+    bool        quoted  = false;
+    bool        started = false;
+    int         depth   = 0;
+
+    for(const QChar c: text)
+        if(c == '"')
+        {
+            quoted  = !quoted;
+            started = true;
+        }
+        else if(c.isSpace() && !quoted && depth == 0)
+        {
+            if(started) ret.append(token);
+            token.clear();
+            started = false;
+        }
+        else
+        {
+            if(c == '(') ++depth;
+            if(c == ')' && depth > 0) --depth;
+            token.append(c);
+            started = true;
+        }
+
+    if(started) ret.append(token);
+
+    return ret;
+}
+
+struct FieldName
+{
+    const char*      prefix;
+    QueryTerm::Field field;
+};
+
+const FieldName field_names[] = {{"ret:", QueryTerm::RET},
+                                 {"tech:", QueryTerm::TECH},
+                                 {"cpuid:", QueryTerm::CPUID},
+                                 {"cat:", QueryTerm::CATEGORY},
+                                 {"param:", QueryTerm::PARAM},
+                                 {"instr:", QueryTerm::INSTRUCTION},
+                                 {"sig:", QueryTerm::SIGNATURE}};
+} // namespace
+
+Query
+parse_query(const QString& text)
+{
+    Query       ret;
+    QStringList words;
+
+    for(QString token: tokens(text))
+    {
+        QueryTerm term;
+        if(token.size() > 1 && token.startsWith('-'))
+        {
+            term.exclude = true;
+            token.remove(0, 1);
+        }
+
+        for(const FieldName& name: field_names)
+            if(token.startsWith(QLatin1String(name.prefix)))
+            {
+                term.field = name.field;
+                token.remove(0, int(std::strlen(name.prefix)));
+                break;
+            }
+
+        if(token.isEmpty()) continue;
+
+        if(term.field == QueryTerm::SEARCH && !term.exclude)
+            words.append(token);
+        else
+        {
+            term.value = token;
+            ret.terms.append(term);
+        }
+    }
+
+    ret.search = words.join(' ');
+
+    return ret;
+}
@@ -0,0 +1,76 @@
+// -*- C++ -*-
+// query.hpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+// Term of the query text: "field:value" or "-field:value" to exclude, a
+// bare "-word" excludes the names and instructions containing it. Values
+// may be quoted and may hold * and ? wildcards, spaces within parentheses
+// don't end them.
+struct QueryTerm
+{
+    enum Field
+    {
+        SEARCH,
+        RET,
+        TECH,
+        CPUID,
+        CATEGORY,
+        PARAM,
+        INSTRUCTION,
+        SIGNATURE
+    };
+
+    Field   field   = SEARCH;
+    QString value;
+    bool    exclude = false;
+};
+
+// What the window filters by. Empty sets and "*" return type match all.
+// Terms with the same field match any of their values, the rest of the
+// query must match all.
+struct Query
+{
+    QString            search;
+    QString            ret = "*";
+    QSet<QString>      techs;
+    QSet<QString>      cpuids;
+    QSet<QString>      categories;
+    QVector<QueryTerm> terms;
+
+    bool
+    isEmpty() const noexcept
+    {
+        return search.isEmpty() && ret == "*" && techs.isEmpty() &&
+               cpuids.isEmpty() && categories.isEmpty() && terms.isEmpty();
+    }
+};
+
+// Query of the text typed in the search field or given to the command
+// line and the server: "ret:", "cpuid:", "tech:", "cat:", "param:",
+// "instr:" and "sig:" tokens become terms, the rest of the words is the
+// search string. For example
+//   ret:__m256i cpuid:AVX2 instr:vpadd* -tech:SVML add
+//   ret:__m128d sig:"int imm8"
+//   sig:(__m512i, __mmask16, const void*)
+Query
+parse_query(const QString& text);
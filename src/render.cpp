@@ -0,0 +1,102 @@
+// -*- C++ -*-
+// render.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "render.hpp"
+
+#include <QJsonArray>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QVector>
+
+QString
+html_parms(const QVector<Var>& parms) noexcept
+{
+    QStringList varlist;
+
+    static const QString type_html = "<font color=darkBlue>%1</font>";
+    static const QString parm_html = "<font color=darkCyan>%1</font>";
+
+    for(const Var& var: parms)
+        varlist.append(type_html.arg(var.type) + ' ' + parm_html.arg(var.name));
+
+    static const QString comma(", ");
+    return varlist.join(comma);
+}
+
+QString
+format_instructions(const QVector<Instruction>& ins) noexcept
+{
+    QStringList list;
+
+    for(const Instruction& i: ins)
+        list.append(QString("%1 %2").arg(i.name.toLower(), i.form));
+
+    return list.join('\n');
+}
+
+RenderedDetails
+render_details(const Intrinsic& i, const Symbols& symbols)
+{
+    RenderedDetails ret;
+
+    static const QString sign_html("<font color=darkBlue>%1</font> %2(%3)");
+    ret.signature =
+        sign_html.arg(symbols.rets[i.ret_type], i.name, html_parms(i.parms));
+
+    static const QString inc_template("#include <%1>");
+    ret.header = inc_template.arg(symbols.headers[i.header]);
+
+    ret.instructions = format_instructions(i.instructions);
+
+    ret.cpuids = symbols.cpuidNames(i.cpuids).join(" + ");
+
+    static const QRegularExpression re_var("\"(\\w+)\"");
+    ret.description = i.description.toString().replace(
+        re_var, "<font color=darkCyan>\\1</font>");
+
+    ret.operation = i.operation.toString();
+
+    return ret;
+}
+
+QString
+signature(const Intrinsic& i, const Symbols& symbols)
+{
+    QStringList varlist;
+
+    for(const Var& var: i.parms) varlist.append(var.type + ' ' + var.name);
+
+    static const QString sign_template("%1 %2(%3)");
+    return sign_template.arg(
+        symbols.rets[i.ret_type], i.name, varlist.join(", "));
+}
+
+QJsonObject
+intrinsic_json(const Intrinsic& i, const Symbols& symbols)
+{
+    QJsonObject ret;
+    ret.insert("name", i.name);
+    ret.insert("signature", signature(i, symbols));
+    ret.insert("tech", symbols.techs[i.tech]);
+    ret.insert("category", symbols.categories[i.category]);
+    ret.insert("header", symbols.headers[i.header]);
+    ret.insert("cpuids",
+               QJsonArray::fromStringList(symbols.cpuidNames(i.cpuids)));
+
+    return ret;
+}
@@ -0,0 +1,46 @@
+// -*- C++ -*-
+// render.hpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "parser.hpp"
+
+#include <QJsonObject>
+#include <QString>
+
+// Texts of the detail view, ready for the labels
+struct RenderedDetails
+{
+    QString signature;
+    QString header;
+    QString instructions;
+    QString cpuids;
+    QString description;
+    QString operation;
+};
+
+RenderedDetails
+render_details(const Intrinsic& i, const Symbols& symbols);
+
+// plain text declaration of the intrinsic
+QString
+signature(const Intrinsic& i, const Symbols& symbols);
+
+// name, signature, tech, category, header and CPUIDs of the intrinsic
+QJsonObject
+intrinsic_json(const Intrinsic& i, const Symbols& symbols);
@@ -0,0 +1,270 @@
+// -*- C++ -*-
+// server.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "server.hpp"
+#include "cli.hpp"
+#include "render.hpp"
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QFutureWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QtConcurrent>
+
+#include <utility>
+
+namespace
+{
+const char* const busy_property = "busy";
+
+constexpr qint64 max_request_length = 4096;
+
+// input of a client waiting while its requests are answered
+constexpr qint64 max_pending = 16 * max_request_length;
+
+// how long a running server has to answer a connection
+constexpr int probe_timeout = 200;
+
+QByteArray
+json_line(const QJsonObject& obj)
+{
+    return QJsonDocument(obj).toJson(QJsonDocument::Compact) + '\n';
+}
+
+QByteArray
+error_line(const QString& error)
+{
+    QJsonObject obj;
+    obj.insert("error", error);
+    return json_line(obj);
+}
+} // namespace
+
+QueryServer::QueryServer(ParseData data, QObject* parent) :
+    QObject(parent),
+    m_data(std::move(data)),
+    m_index(m_data.intrinsics, m_data.symbols)
+{
+    for(int n = 0; n < m_data.intrinsics.count(); ++n)
+        m_names[m_data.intrinsics[n].name].append(n);
+
+    m_text_build = QtConcurrent::run([this]() { m_index.text(); });
+
+    p_server->setSocketOptions(QLocalServer::UserAccessOption);
+    QObject::connect(p_server,
+                     &QLocalServer::newConnection,
+                     this,
+                     &QueryServer::acceptClients);
+}
+
+QueryServer::~QueryServer()
+{
+    m_text_build.waitForFinished();
+    m_requests.waitForDone();
+}
+
+bool
+QueryServer::listen(const QString& socket_name)
+{
+    m_error.clear();
+
+    QLocalSocket probe;
+    probe.connectToServer(socket_name);
+    if(probe.waitForConnected(probe_timeout))
+    {
+        m_error = "another server is running on the socket";
+        return false;
+    }
+
+    QLocalServer::removeServer(socket_name);
+    return p_server->listen(socket_name);
+}
+
+QString
+QueryServer::errorString() const
+{
+    return m_error.isEmpty() ? p_server->errorString() : m_error;
+}
+
+void
+QueryServer::acceptClients()
+{
+    while(QLocalSocket* socket = p_server->nextPendingConnection())
+    {
+        QObject::connect(socket,
+                         &QLocalSocket::disconnected,
+                         socket,
+                         &QObject::deleteLater);
+        QObject::connect(socket,
+                         &QLocalSocket::readyRead,
+                         this,
+                         [this, socket]() { readRequests(socket); });
+    }
+}
+
+void
+QueryServer::readRequests(QLocalSocket* socket)
+{
+    if(socket->state() != QLocalSocket::ConnectedState) return;
+
+    // input keeps coming while a request is answered, not without bound
+    if(socket->bytesAvailable() > max_pending)
+    {
+        dropClient(socket, "Too many pending requests");
+        return;
+    }
+
+    // the next request is read once the running one is answered
+    while(!socket->property(busy_property).toBool() && socket->canReadLine())
+    {
+        const QByteArray line = socket->readLine(max_request_length);
+        if(!line.endsWith('\n'))
+        {
+            dropClient(socket, "Request too long");
+            return;
+        }
+
+        const QByteArray request = line.trimmed();
+
+        // lookups are a hash probe, cheaper than a trip to the pool
+        if(request.startsWith("lookup "))
+        {
+            socket->write(answer(request));
+            continue;
+        }
+
+        socket->setProperty(busy_property, true);
+
+        auto* watcher = new QFutureWatcher<QByteArray>(socket);
+        QObject::connect(watcher,
+                         &QFutureWatcherBase::finished,
+                         socket,
+                         [this, socket, watcher]()
+                         {
+                             socket->write(watcher->result());
+                             socket->setProperty(busy_property, false);
+                             watcher->deleteLater();
+                             readRequests(socket);
+                         });
+        watcher->setFuture(QtConcurrent::run(
+            &m_requests, [this, request]() { return answer(request); }));
+    }
+
+    // a partial line can't grow past the cap either
+    if(!socket->canReadLine() &&
+       socket->bytesAvailable() >= max_request_length)
+        dropClient(socket, "Request too long");
+}
+
+void
+QueryServer::dropClient(QLocalSocket* socket, const QString& error)
+{
+    socket->write(error_line(error) + '\n');
+    socket->disconnectFromServer();
+}
+
+QByteArray
+QueryServer::answer(const QByteArray& request) const
+{
+    const int        space   = request.indexOf(' ');
+    const QByteArray command = request.left(space);
+    const QString    arg =
+        space == -1 ? QString() : QString::fromUtf8(request.mid(space + 1));
+    const Symbols&   symbols = *m_data.symbols;
+
+    QByteArray ret;
+    auto       add_line = [&](const int n)
+    { ret += json_line(intrinsic_json(m_data.intrinsics[n], symbols)); };
+
+    if(command == "lookup")
+        for(const int n: m_names.value(arg)) add_line(n);
+    else if(command == "search")
+        for(const int n: m_index.ranked(parse_query(arg))) add_line(n);
+    else if(command == "details")
+        for(const int n: m_names.value(arg))
+        {
+            const Intrinsic& i   = m_data.intrinsics[n];
+            QJsonObject      obj = intrinsic_json(i, symbols);
+
+            QJsonArray instructions;
+            for(const Instruction& ins: i.instructions)
+                instructions.append(ins.name.toLower() + ' ' + ins.form);
+
+            obj.insert("instructions", instructions);
+            obj.insert("description", i.description.toString());
+            obj.insert("operation", i.operation.toString());
+            ret += json_line(obj);
+        }
+    else
+        ret += error_line(
+            QString("Unknown request: %1").arg(QString::fromUtf8(command)));
+
+    return ret + '\n';
+}
+
+int
+run_server(const QStringList&  arguments,
+           const QString&      data_path,
+           const ParseOptions& options)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Answers intrinsics queries over a local socket.");
+    parser.addHelpOption();
+
+    const QCommandLineOption serve_opt("serve", "Run the query server.");
+    const QCommandLineOption data_opt("data", "Intrinsics data file.", "file");
+    const QCommandLineOption socket_opt(
+        "socket", "Socket name or path.", "socket", "miniguide");
+    const QCommandLineOption trace_opt(
+        "trace", "Write a Chrome trace of the run.", "file");
+    parser.addOptions({serve_opt, data_opt, socket_opt, trace_opt});
+    parser.process(arguments);
+
+    QTextStream err(stderr);
+
+    QFile data_file(parser.isSet(data_opt) ? parser.value(data_opt) :
+                                             data_path);
+
+    ParseData data;
+    try
+    {
+        data = parse_doc(&data_file, options);
+    }
+    catch(const ParsingError& ex)
+    {
+        err << "Failed to parse " << data_file.fileName() << ": "
+            << error_text(ex) << '\n';
+        return 1;
+    }
+
+    QueryServer server(std::move(data));
+    if(!server.listen(parser.value(socket_opt)))
+    {
+        err << "Could not listen on " << parser.value(socket_opt) << ": "
+            << server.errorString() << '\n';
+        return 1;
+    }
+
+    return QCoreApplication::exec();
+}
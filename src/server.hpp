@@ -0,0 +1,93 @@
+// -*- C++ -*-
+// server.hpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "index.hpp"
+#include "parser.hpp"
+
+#include <QByteArray>
+#include <QFuture>
+#include <QHash>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+// Answers queries of local clients over a Unix domain socket. Requests and
+// answers are UTF-8 lines:
+//
+//     lookup <name>    intrinsics with the name
+//     search <query>   intrinsics matching the query, as in --batch
+//     details <name>   intrinsics with the name, with the description,
+//                      operation and instructions
+//
+// Every answer is a JSON object per intrinsic, or an object with an
+// "error" member, and ends with an empty line. A client sending a line of
+// 4 KiB or more, or 64 KiB of requests waiting for answers, gets an error
+// and is disconnected. The data is immutable
+// once loaded, so searches of many clients run on the thread pool at once,
+// while every client gets its answers in the order of its requests.
+class QueryServer : public QObject
+{
+    Q_OBJECT
+
+    QLocalServer*                p_server = new QLocalServer(this);
+    const ParseData              m_data;
+    const FilterIndex            m_index;
+    QHash<QString, QVector<int>> m_names;
+    QFuture<void>                m_text_build;
+    QThreadPool                  m_requests;
+    QString                      m_error;
+
+    void
+    acceptClients();
+
+    void
+    readRequests(QLocalSocket* socket);
+
+    // answers a client over the limits with the error and disconnects it
+    void
+    dropClient(QLocalSocket* socket, const QString& error);
+
+    QByteArray
+    answer(const QByteArray& request) const;
+
+  public:
+    QueryServer(ParseData data, QObject* parent = nullptr);
+
+    // waits for the text index the constructor builds in the background and
+    // for the requests being answered
+    ~QueryServer() override;
+
+    // Starts listening on the socket. A stale socket is replaced, one a
+    // running server answers on is left to it.
+    bool
+    listen(const QString& socket_name);
+
+    QString
+    errorString() const;
+};
+
+int
+run_server(const QStringList&  arguments,
+           const QString&      data_path,
+           const ParseOptions& options);
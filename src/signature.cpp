@@ -0,0 +1,216 @@
+// -*- C++ -*-
+// signature.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "signature.hpp"
+
+#include <QStringList>
+#include <QVarLengthArray>
+
+#include <algorithm>
+
+namespace
+{
+template <typename Key>
+Bitset&
+bitset_of(QHash<Key, Bitset>& bitsets, const Key& key, const int count)
+{
+    auto it = bitsets.find(key);
+    if(it == bitsets.end()) it = bitsets.insert(key, Bitset(count));
+
+    return *it;
+}
+
+// parameter of a searched signature
+struct Parm
+{
+    QHash<QString, int>::const_iterator type;
+    QString                             name;
+};
+} // namespace
+
+QString
+SignatureIndex::normalType(const QString& type)
+{
+    QString spaced = type.toLower();
+    spaced.replace('*', " * ");
+
+    // const goes first and only matters for pointers, the parameters are
+    // copies otherwise; the pointers stick to the type
+    bool        constant = false;
+    QStringList words;
+    for(const QString& word: spaced.split(' ', Qt::SkipEmptyParts))
+        if(word == "const")
+            constant = true;
+        else
+            words.append(word);
+    if(constant && words.contains("*")) words.prepend("const");
+
+    return words.join(' ').replace(" *", "*");
+}
+
+SignatureIndex::SignatureIndex(const Intrinsics& intrinsics) :
+    m_all(intrinsics.count(), true)
+{
+    const int count = intrinsics.count();
+
+    m_offsets.reserve(count + 1);
+    m_offsets.append(0);
+
+    for(int n = 0; n < count; ++n)
+    {
+        int arity = 0;
+        for(const Var& parm: intrinsics[n].parms)
+        {
+            const QString type = normalType(parm.type);
+
+            // "(void)" lists no parameters
+            if(type == "void" && parm.name.isEmpty()) continue;
+
+            auto id = m_type_ids.find(type);
+            if(id == m_type_ids.end())
+                id = m_type_ids.insert(type, m_type_ids.count());
+
+            bitset_of(m_types, type, count).set(n);
+            bitset_of(m_positions, positionKey(arity, *id), count).set(n);
+
+            m_parm_types.append(*id);
+            m_parm_names.append(parm.name.toLower());
+            ++arity;
+        }
+
+        while(m_arities.count() <= arity) m_arities.append(Bitset(count));
+        m_arities[arity].set(n);
+
+        m_offsets.append(m_parm_types.count());
+    }
+}
+
+Bitset
+SignatureIndex::find(const QString& signature) const
+{
+    const Bitset none(m_all.size());
+
+    QString    text   = signature.trimmed();
+    const bool listed = text.startsWith('(') && text.endsWith(')');
+    if(listed) text = text.mid(1, text.size() - 2);
+
+    QStringList specs = text.split(',', Qt::SkipEmptyParts);
+    for(QString& spec: specs) spec = normalType(spec);
+    specs.removeAll(QString());
+
+    const bool prefix = listed && !specs.isEmpty() && specs.last() == "...";
+    if(prefix) specs.removeLast();
+
+    // (void) lists no parameters, as the index has it
+    if(listed && specs == QStringList{"void"}) specs.clear();
+
+    // a parameter is a known type or a known type and a name
+    QVector<Parm> parms;
+    bool          named = false;
+    for(const QString& spec: specs)
+    {
+        auto type = m_type_ids.constFind(spec);
+        if(type != m_type_ids.cend())
+        {
+            parms.append({type, {}});
+            continue;
+        }
+
+        const int space = spec.lastIndexOf(' ');
+        if(space == -1) return none;
+
+        type = m_type_ids.constFind(spec.left(space));
+        if(type == m_type_ids.cend()) return none;
+
+        parms.append({type, spec.mid(space + 1)});
+        named = true;
+    }
+
+    Bitset ret      = m_all;
+    bool   repeated = false;
+
+    if(listed)
+    {
+        const int arity = parms.count();
+        if(!prefix) ret &= arity < m_arities.count() ? m_arities[arity] : none;
+
+        for(int k = 0; k < arity && ret.any(); ++k)
+        {
+            const auto at =
+                m_positions.constFind(positionKey(k, *parms[k].type));
+            ret &= at != m_positions.cend() ? *at : none;
+        }
+    }
+    else
+        for(int k = 0; k < parms.count() && ret.any(); ++k)
+        {
+            ret &= m_types[parms[k].type.key()];
+            for(int j = 0; j < k; ++j)
+                repeated = repeated || parms[j].type == parms[k].type;
+        }
+
+    if(!(named || repeated) || !ret.any()) return ret;
+
+    // The bitsets can't tell the names or how many parameters have a type.
+    // Named parameters are matched first, as any parameter of their type
+    // would do for the rest.
+    if(!listed)
+        std::stable_sort(parms.begin(),
+                         parms.end(),
+                         [](const Parm& a, const Parm& b)
+                         { return !a.name.isEmpty() && b.name.isEmpty(); });
+
+    const auto has_parms = [&](const int n)
+    {
+        const int begin = m_offsets[n];
+        const int arity = m_offsets[n + 1] - begin;
+
+        if(listed)
+        {
+            for(int k = 0; k < parms.count(); ++k)
+                if(!parms[k].name.isEmpty() &&
+                   m_parm_names[begin + k] != parms[k].name)
+                    return false;
+            return true;
+        }
+
+        QVarLengthArray<bool, 16> used(arity);
+        std::fill(used.begin(), used.end(), false);
+        for(const Parm& parm: parms)
+        {
+            int j = 0;
+            while(j < arity &&
+                  (used[j] || m_parm_types[begin + j] != *parm.type ||
+                   (!parm.name.isEmpty() &&
+                    m_parm_names[begin + j] != parm.name)))
+                ++j;
+            if(j == arity) return false;
+            used[j] = true;
+        }
+        return true;
+    };
+
+    Bitset checked = none;
+    ret.forEach(
+        [&](const int n)
+        {
+            if(has_parms(n)) checked.set(n);
+        });
+
+    return checked;
+}
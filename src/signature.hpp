@@ -0,0 +1,79 @@
+// -*- C++ -*-
+// signature.hpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "bitset.hpp"
+#include "parser.hpp"
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+// Index of the parameter lists: bitsets of the intrinsics per parameter
+// type, per type at a position and per arity, and the types and names of
+// all parameters to check the names. Types are normalized, "void const *"
+// and "const void*" are the same, so are "const int" and "int", and kept in
+// lower case.
+//
+// Signatures are searched as
+//   (t1, t2, t3)    exactly these parameters
+//   (t1, t2, ...)   parameters starting with these
+//   t1, t2          parameters containing these in any order
+// where a parameter is a type optionally followed by its name, "int imm8",
+// and (void) is the empty list.
+class SignatureIndex
+{
+    QHash<QString, int>    m_type_ids;
+    QHash<QString, Bitset> m_types;
+    QHash<quint32, Bitset> m_positions;
+    QVector<Bitset>        m_arities;
+    Bitset                 m_all;
+
+    // type IDs and names of the parameters of intrinsic n are at
+    // m_offsets[n] to m_offsets[n + 1]
+    QVector<int>     m_offsets;
+    QVector<int>     m_parm_types;
+    QVector<QString> m_parm_names;
+
+    static quint32
+    positionKey(const int position, const int type) noexcept
+    {
+        return quint32(position) << 16 | quint32(type);
+    }
+
+  public:
+    SignatureIndex() = default;
+
+    explicit SignatureIndex(const Intrinsics& intrinsics);
+
+    // the spelling of the type the index keeps
+    static QString
+    normalType(const QString& type);
+
+    // intrinsics per normalized parameter type
+    const QHash<QString, Bitset>&
+    types() const noexcept
+    {
+        return m_types;
+    }
+
+    // intrinsics with the signature, empty if it names unknown types
+    Bitset
+    find(const QString& signature) const;
+};
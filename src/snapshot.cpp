@@ -0,0 +1,334 @@
+// -*- C++ -*-
+// snapshot.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "snapshot.hpp"
+#include "trace.hpp"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <array>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+// Layout: header, key, raw UTF-8 texts, symbol tables, then the rest of
+// ParseData.
+// Descriptions and operations are spans of the texts block, so they are
+// used right from the mapped snapshot. The block and its offsets are 64
+// bit and it is written and read through the file, never held whole in a
+// QByteArray. Bump the version on any change.
+static constexpr quint32 snapshot_magic   = 0x4d494753; // MIGS
+static constexpr quint32 snapshot_version = 3;
+static constexpr auto    stream_version   = QDataStream::Qt_5_12;
+
+static quint64
+content_hash(const char* data, const qint64 size) noexcept
+{
+    // FNV-1a over 64 bit words with extra folding of the high bits
+    constexpr quint64 prime = 0x100000001b3ULL;
+    quint64           hash  = 0xcbf29ce484222325ULL;
+
+    qint64 i = 0;
+    for(; i + 8 <= size; i += 8)
+    {
+        quint64 word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 32;
+    }
+    for(; i < size; ++i) hash = (hash ^ static_cast<uchar>(data[i])) * prime;
+
+    return hash;
+}
+
+SnapshotKey
+snapshot_key(const QString& data_path, const TextStore& data)
+{
+    TRACE_SCOPE("snapshot_key");
+
+    const QFileInfo info(data_path);
+    return SnapshotKey{info.absoluteFilePath(),
+                       data.size(),
+                       info.lastModified().toMSecsSinceEpoch(),
+                       content_hash(data.data(), data.size())};
+}
+
+// data files of the same name in different directories get snapshots of
+// their own through a hash of the absolute path
+QString
+snapshot_path(const QString& dir, const QString& data_path)
+{
+    const QFileInfo  info(data_path);
+    const QByteArray path = info.absoluteFilePath().toUtf8();
+    const quint32    hash = quint32(content_hash(path.data(), path.size()));
+
+    return QDir(dir).filePath(QString("%1-%2.snapshot")
+                                  .arg(info.completeBaseName())
+                                  .arg(hash, 8, 16, QChar('0')));
+}
+
+template <typename SymbolsT>
+static auto
+tables(SymbolsT& symbols) noexcept
+{
+    return std::array{&symbols.techs,
+                      &symbols.categories,
+                      &symbols.rets,
+                      &symbols.headers,
+                      &symbols.cpuids};
+}
+
+struct TextSpan
+{
+    qint64  offset = 0;
+    quint32 size   = 0;
+};
+
+// writes the text at the end of the texts block starting at base
+static TextSpan
+write_text(QDataStream& out, const qint64 base, const LazyText& text)
+{
+    const QByteArray utf8 = text.toString().toUtf8();
+    const TextSpan   ret{out.device()->pos() - base,
+                       static_cast<quint32>(utf8.size())};
+    out.writeRawData(utf8.constData(), utf8.size());
+    return ret;
+}
+
+bool
+save_snapshot(const QString&     path,
+              const SnapshotKey& key,
+              const ParseData&   data)
+{
+    TRACE_SCOPE("save_snapshot");
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if(!file.open(QIODevice::WriteOnly)) return false;
+
+    QDataStream out(&file);
+    out.setVersion(stream_version);
+
+    out << snapshot_magic << snapshot_version;
+    out << key.path << key.size << key.mtime << key.hash;
+
+    // the texts go right to the file, their size once it is known
+    const qint64 size_pos = file.pos();
+    out << qint64(0);
+    const qint64 texts_base = file.pos();
+
+    QVector<TextSpan> spans;
+    spans.reserve(data.intrinsics.count() * 2);
+    for(const Intrinsic& i: data.intrinsics)
+    {
+        spans.append(write_text(out, texts_base, i.description));
+        spans.append(write_text(out, texts_base, i.operation));
+    }
+
+    const qint64 texts_end = file.pos();
+    if(!file.seek(size_pos)) return false;
+    out << texts_end - texts_base;
+    if(!file.seek(texts_end)) return false;
+
+    out << data.version << data.date;
+
+    const Symbols& symbols = *data.symbols;
+    for(const SymbolTable* table: tables(symbols)) out << table->names();
+
+    out << static_cast<quint32>(data.technologies.count());
+    for(const Tech& t: data.technologies) out << t.family << t.techs;
+
+    out << data.categories << data.rets;
+
+    out << static_cast<quint32>(data.intrinsics.count());
+    auto span = spans.cbegin();
+    for(const Intrinsic& i: data.intrinsics)
+    {
+        out << i.name << i.tech << i.category << i.ret_type << i.header;
+
+        const auto cpuids = static_cast<quint8>(i.cpuids.count());
+        out << cpuids;
+        for(int id = 0; id < symbols.cpuids.count(); ++id)
+            if(i.cpuids.test(static_cast<std::size_t>(id)))
+                out << static_cast<SymbolID>(id);
+
+        out << static_cast<quint32>(i.parms.count());
+        for(const Var& v: i.parms) out << v.name << v.type;
+
+        for(int t = 0; t < 2; ++t, ++span) out << span->offset << span->size;
+
+        out << static_cast<quint32>(i.instructions.count());
+        for(const Instruction& in: i.instructions)
+            out << in.name << in.form << in.xed;
+    }
+
+    if(out.status() != QDataStream::Ok)
+    {
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
+}
+
+std::optional<ParseData>
+load_snapshot(const QString& path, const SnapshotKey& key)
+{
+    TRACE_SCOPE("load_snapshot");
+
+    if(!QFileInfo::exists(path)) return std::nullopt;
+
+    // the texts are used from the mapping, the rest is read through the file
+    const auto store = std::make_shared<const TextStore>(path);
+    if(!store->isValid()) return std::nullopt;
+
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly)) return std::nullopt;
+
+    QDataStream in(&file);
+    in.setVersion(stream_version);
+
+    quint32 magic   = 0;
+    quint32 version = 0;
+    in >> magic >> version;
+    if(magic != snapshot_magic || version != snapshot_version)
+        return std::nullopt;
+
+    SnapshotKey stored;
+    in >> stored.path >> stored.size >> stored.mtime >> stored.hash;
+    if(stored.path != key.path || stored.size != key.size ||
+       stored.mtime != key.mtime || stored.hash != key.hash)
+        return std::nullopt;
+
+    qint64 texts_size = 0;
+    in >> texts_size;
+    const qint64 texts_base = file.pos();
+    if(in.status() != QDataStream::Ok || texts_size < 0 ||
+       texts_size > store->size() - texts_base ||
+       !file.seek(texts_base + texts_size))
+        return std::nullopt;
+
+    bool       bad_span = false;
+    const auto text     = [&]()
+    {
+        TextSpan span;
+        in >> span.offset >> span.size;
+        if(span.offset < 0 || span.offset > texts_size - span.size)
+        {
+            bad_span = true;
+            return LazyText();
+        }
+        return LazyText(store, texts_base + span.offset, span.size, false);
+    };
+
+    // counts come from the file, do not trust them for reservations
+    const auto reservable = [&](const quint32 count)
+    { return static_cast<int>(qMin<qint64>(count, store->size())); };
+
+    ParseData ret;
+    in >> ret.version >> ret.date;
+
+    auto symbols = std::make_shared<Symbols>();
+    for(SymbolTable* table: tables(*symbols))
+    {
+        QStringList names;
+        in >> names;
+
+        // IDs are the positions, so they survive interning in order
+        for(const QString& name: names) table->intern(name);
+        if(table->count() != names.count()) return std::nullopt;
+    }
+    if(symbols->cpuids.count() > max_cpuids) return std::nullopt;
+
+    bool       bad_id = false;
+    const auto id     = [&](const SymbolTable& table)
+    {
+        SymbolID v = 0;
+        in >> v;
+        if(v < table.count()) return v;
+
+        bad_id = true;
+        return SymbolID(0);
+    };
+
+    quint32 count = 0;
+    in >> count;
+    ret.technologies.reserve(reservable(count));
+    for(quint32 t = 0; t < count && in.status() == QDataStream::Ok; ++t)
+    {
+        Tech tech;
+        in >> tech.family >> tech.techs;
+        ret.technologies.append(std::move(tech));
+    }
+
+    in >> ret.categories >> ret.rets;
+
+    in >> count;
+    ret.intrinsics.reserve(reservable(count));
+    for(quint32 n = 0; n < count && in.status() == QDataStream::Ok; ++n)
+    {
+        Intrinsic i;
+        in >> i.name;
+        i.tech     = id(symbols->techs);
+        i.category = id(symbols->categories);
+        i.ret_type = id(symbols->rets);
+        i.header   = id(symbols->headers);
+
+        quint8 cpuids = 0;
+        in >> cpuids;
+        for(quint8 c = 0; c < cpuids; ++c) i.cpuids.set(id(symbols->cpuids));
+
+        quint32 parms = 0;
+        in >> parms;
+        i.parms.reserve(reservable(parms));
+        for(quint32 p = 0; p < parms && in.status() == QDataStream::Ok; ++p)
+        {
+            Var v;
+            in >> v.name >> v.type;
+            i.parms.append(std::move(v));
+        }
+
+        i.description = text();
+        i.operation   = text();
+
+        quint32 instructions = 0;
+        in >> instructions;
+        i.instructions.reserve(reservable(instructions));
+        for(quint32 p = 0; p < instructions && in.status() == QDataStream::Ok;
+            ++p)
+        {
+            Instruction ins;
+            in >> ins.name >> ins.form >> ins.xed;
+            i.instructions.append(std::move(ins));
+        }
+
+        ret.intrinsics.append(std::move(i));
+    }
+
+    if(in.status() != QDataStream::Ok || bad_span || bad_id)
+        return std::nullopt;
+
+    ret.symbols = std::move(symbols);
+
+    return ret;
+}
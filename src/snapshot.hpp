@@ -0,0 +1,50 @@
+// -*- C++ -*-
+// snapshot.hpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "parser.hpp"
+#include "textstore.hpp"
+
+#include <QString>
+
+#include <optional>
+
+// Identifies the data file a snapshot was made from
+struct SnapshotKey
+{
+    QString path;
+    qint64  size  = 0;
+    qint64  mtime = 0;
+    quint64 hash  = 0;
+};
+
+SnapshotKey
+snapshot_key(const QString& data_path, const TextStore& data);
+
+QString
+snapshot_path(const QString& dir, const QString& data_path);
+
+// Returns nothing if there is no snapshot for the key
+std::optional<ParseData>
+load_snapshot(const QString& path, const SnapshotKey& key);
+
+bool
+save_snapshot(const QString&     path,
+              const SnapshotKey& key,
+              const ParseData&   data);
@@ -0,0 +1,90 @@
+// -*- C++ -*-
+// symbols.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "symbols.hpp"
+
+SymbolID
+SymbolTable::intern(const QString& name)
+{
+    const auto it = m_ids.constFind(name);
+    if(it != m_ids.cend()) return it.value();
+
+    const SymbolID id = static_cast<SymbolID>(m_names.count());
+    m_names.append(name);
+    m_ids.insert(name, id);
+    return id;
+}
+
+SymbolID
+SymbolTable::find(const QString& name) const noexcept
+{
+    return m_ids.value(name, none);
+}
+
+Symbols::Symbols()
+{
+    for(SymbolTable* table: {&techs, &categories, &rets, &headers})
+        table->intern(QString());
+}
+
+QStringList
+Symbols::cpuidNames(const CpuidMask& mask) const
+{
+    QStringList ret;
+
+    for(int id = 0; id < cpuids.count(); ++id)
+        if(mask.test(static_cast<std::size_t>(id)))
+            ret.append(cpuids[static_cast<SymbolID>(id)]);
+
+    return ret;
+}
+
+CpuidMask
+Symbols::cpuidMask(const QStringList& names) const
+{
+    CpuidMask ret;
+
+    for(const QString& name: names)
+    {
+        const SymbolID id = cpuids.find(name);
+        if(id != SymbolTable::none) ret.set(id);
+    }
+
+    return ret;
+}
+
+static QVector<SymbolID>
+merge_table(SymbolTable& to, const SymbolTable& from)
+{
+    QVector<SymbolID> ret;
+    ret.reserve(from.count());
+
+    for(const QString& name: from.names()) ret.append(to.intern(name));
+
+    return ret;
+}
+
+Symbols::Remap
+Symbols::merge(const Symbols& other)
+{
+    return Remap{merge_table(techs, other.techs),
+                 merge_table(categories, other.categories),
+                 merge_table(rets, other.rets),
+                 merge_table(headers, other.headers),
+                 merge_table(cpuids, other.cpuids)};
+}
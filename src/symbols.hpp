@@ -0,0 +1,105 @@
+// -*- C++ -*-
+// symbols.hpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <bitset>
+
+using SymbolID = quint16;
+
+// Interned strings: every distinct value gets a small integer ID. IDs are
+// handed out in the order of the first occurrence and are never reused.
+class SymbolTable
+{
+    QStringList              m_names;
+    QHash<QString, SymbolID> m_ids;
+
+  public:
+    static constexpr SymbolID none = 0xffff;
+
+    // ID of the string, it is added if not known yet
+    SymbolID
+    intern(const QString& name);
+
+    // ID of the string or none
+    SymbolID
+    find(const QString& name) const noexcept;
+
+    const QString&
+    operator[](const SymbolID id) const noexcept
+    {
+        return m_names[id];
+    }
+
+    const QStringList&
+    names() const noexcept
+    {
+        return m_names;
+    }
+
+    int
+    count() const noexcept
+    {
+        return m_names.count();
+    }
+};
+
+// CPUIDs are bit positions, the ID in the cpuids table
+constexpr int max_cpuids = 128;
+
+using CpuidMask = std::bitset<max_cpuids>;
+
+// ID 0 of every table but cpuids is the empty string, the value of fields
+// missing in the data.
+struct Symbols
+{
+    Symbols();
+
+    SymbolTable techs;
+    SymbolTable categories;
+    SymbolTable rets;
+    SymbolTable headers;
+    SymbolTable cpuids;
+
+    // names of the CPUIDs in ID order
+    QStringList
+    cpuidNames(const CpuidMask& mask) const;
+
+    // mask of the known CPUIDs among the names
+    CpuidMask
+    cpuidMask(const QStringList& names) const;
+
+    // Maps IDs of other tables onto these ones, adding missing names.
+    // Holds a remap vector per table, indexed by the other ID.
+    struct Remap
+    {
+        QVector<SymbolID> techs;
+        QVector<SymbolID> categories;
+        QVector<SymbolID> rets;
+        QVector<SymbolID> headers;
+        QVector<SymbolID> cpuids;
+    };
+
+    Remap
+    merge(const Symbols& other);
+};
@@ -0,0 +1,227 @@
+// -*- C++ -*-
+// textindex.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "textindex.hpp"
+#include "trace.hpp"
+
+#include <QSet>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+// BM25 parameters
+constexpr float k1 = 1.2f;
+constexpr float b  = 0.75f;
+
+constexpr float description_weight = 2.0f;
+
+// longest suffixes first
+const char* const suffixes[] = {"ations",
+                                 "ation",
+                                 "ating",
+                                 "ated",
+                                 "ates",
+                                 "ate",
+                                 "ing",
+                                 "ly",
+                                 "ed",
+                                 "es",
+                                 "e",
+                                 "s"};
+
+constexpr int min_stem = 3;
+
+// words of every description or of the pseudocode
+const QSet<QString> stop_words{
+    "the", "of", "and", "in", "to", "from", "is", "are", "by", "with", "an",
+    "at", "for", "or", "be", "it", "as", "if", "fi", "else", "endfor",
+    "return", "dst", "tmp"};
+
+QString
+stem(QString word)
+{
+    if(word.front().isDigit()) return word;
+
+    for(const char* suffix: suffixes)
+    {
+        const int length = int(std::strlen(suffix));
+        if(word.size() - length >= min_stem &&
+           word.endsWith(QLatin1String(suffix)))
+        {
+            word.chop(length);
+            break;
+        }
+    }
+
+    return word;
+}
+} // namespace
+
+QStringList
+TextIndex::words(const QString& text)
+{
+    QStringList ret;
+    QString     word;
+    QChar       last;
+
+    const auto end_word = [&]()
+    {
+        if(word.size() > 1)
+        {
+            const QString lower = word.toLower();
+            if(!stop_words.contains(lower)) ret.append(stem(lower));
+        }
+        word.clear();
+    };
+
+    for(const QChar c: text)
+    {
+        if(!c.isLetterOrNumber())
+        {
+            end_word();
+            continue;
+        }
+
+        if(!word.isEmpty() && ((c.isUpper() && last.isLower()) ||
+                               c.isDigit() != last.isDigit()))
+            end_word();
+
+        word.append(c);
+        last = c;
+    }
+    end_word();
+
+    return ret;
+}
+
+TextIndex::TextIndex(const Intrinsics& intrinsics) :
+    m_lengths(intrinsics.count(), 0.0f)
+{
+    TRACE_SCOPE("TextIndex");
+
+    QHash<QString, float> frequencies;
+    double                total = 0;
+
+    for(int n = 0; n < intrinsics.count(); ++n)
+    {
+        const Intrinsic& i = intrinsics[n];
+
+        frequencies.clear();
+        for(const QString& word: words(i.description.toString()))
+            frequencies[word] += description_weight;
+        for(const QString& word: words(i.operation.toString()))
+            frequencies[word] += 1.0f;
+
+        for(auto it = frequencies.cbegin(); it != frequencies.cend(); ++it)
+        {
+            m_postings[it.key()].append({n, it.value()});
+            m_lengths[n] += it.value();
+        }
+        total += double(m_lengths[n]);
+    }
+
+    if(!intrinsics.isEmpty())
+        m_average_length = float(total / intrinsics.count());
+
+    for(QVector<Posting>& postings: m_postings) postings.squeeze();
+}
+
+QVector<float>
+TextIndex::scores(const QString& text, const Bitset& candidates) const
+{
+    QVector<float> ret(m_lengths.count(), 0.0f);
+    const float    count = float(m_lengths.count());
+
+    QStringList terms = words(text);
+    terms.removeDuplicates();
+
+    for(const QString& term: terms)
+    {
+        const auto postings = m_postings.constFind(term);
+        if(postings == m_postings.cend()) continue;
+
+        const float df  = float(postings->count());
+        const float idf = std::log(1.0f + (count - df + 0.5f) / (df + 0.5f));
+
+        for(const Posting& p: *postings)
+            if(candidates.test(p.position))
+            {
+                const float norm =
+                    k1 * (1 - b + b * m_lengths[p.position] / m_average_length);
+                ret[p.position] +=
+                    idf * p.frequency * (k1 + 1) / (p.frequency + norm);
+            }
+    }
+
+    return ret;
+}
+
+Bitset
+TextIndex::find(const QString& text, const Bitset& candidates) const
+{
+    Bitset ret(candidates.size());
+
+    for(const QString& term: words(text))
+    {
+        const auto postings = m_postings.constFind(term);
+        if(postings == m_postings.cend()) continue;
+
+        for(const Posting& p: *postings)
+            if(candidates.test(p.position)) ret.set(p.position);
+    }
+
+    return ret;
+}
+
+QVector<int>
+TextIndex::rank(const QString& text, const Bitset& matches, const int k) const
+{
+    struct Scored
+    {
+        float score;
+        int   position;
+    };
+
+    const QVector<float> score = scores(text, matches);
+
+    QVector<Scored> scored;
+    scored.reserve(matches.count());
+    matches.forEach([&](const int n) { scored.append({score[n], n}); });
+
+    const auto better = [](const Scored& lhs, const Scored& rhs) noexcept
+    {
+        if(lhs.score != rhs.score) return lhs.score > rhs.score;
+        return lhs.position < rhs.position;
+    };
+
+    const auto top = scored.begin() + std::min(k, scored.count());
+    std::partial_sort(scored.begin(), top, scored.end(), better);
+    std::sort(top,
+              scored.end(),
+              [](const Scored& lhs, const Scored& rhs) noexcept
+              { return lhs.position < rhs.position; });
+
+    QVector<int> ret;
+    ret.reserve(scored.count());
+    for(const Scored& s: scored) ret.append(s.position);
+
+    return ret;
+}
@@ -0,0 +1,68 @@
+// -*- C++ -*-
+// textindex.hpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "bitset.hpp"
+#include "parser.hpp"
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Inverted index of the words of descriptions and operations, ranking the
+// intrinsics having any of the searched words by BM25. Words are split at
+// case and digit changes, "SignedSaturate16" gives "signed", "saturate" and
+// "16", and stripped of common suffixes, so "saturate" finds "saturation".
+// Description words weigh twice as much as operation ones.
+class TextIndex
+{
+    struct Posting
+    {
+        int   position;
+        float frequency;
+    };
+
+    QHash<QString, QVector<Posting>> m_postings;
+    QVector<float>                   m_lengths;
+    float                            m_average_length = 0;
+
+    // BM25 score of the intrinsics having the words of the text, zero for
+    // the rest and those outside of the candidates
+    QVector<float>
+    scores(const QString& text, const Bitset& candidates) const;
+
+  public:
+    TextIndex() = default;
+
+    explicit TextIndex(const Intrinsics& intrinsics);
+
+    // words of the text as they are indexed
+    static QStringList
+    words(const QString& text);
+
+    // candidates having any of the words of the text
+    Bitset
+    find(const QString& text, const Bitset& candidates) const;
+
+    // Positions of the matches, the best k by score first, earlier
+    // positions winning ties, the rest by position.
+    QVector<int>
+    rank(const QString& text, const Bitset& matches, const int k) const;
+};
@@ -0,0 +1,134 @@
+// -*- C++ -*-
+// textstore.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "textstore.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+TextStore::TextStore(const QString& path) : m_file(path)
+{
+    if(!m_file.open(QIODevice::ReadOnly)) return;
+
+    m_size = m_file.size();
+
+    if(uchar* mapped = m_file.map(0, m_size))
+        p_data = reinterpret_cast<const char*>(mapped);
+    else if(m_size < std::numeric_limits<int>::max())
+    {
+        m_buffer = m_file.readAll();
+        m_size   = m_buffer.size();
+        p_data   = m_buffer.constData();
+        m_file.close();
+    }
+}
+
+TextStore::TextStore(QByteArray bytes) :
+    m_buffer(std::move(bytes)),
+    p_data(m_buffer.constData()),
+    m_size(m_buffer.size())
+{
+}
+
+static void
+append_entity(QString& out, const char* begin, const char* end)
+{
+    const QByteArray name = QByteArray::fromRawData(begin, end - begin);
+
+    if(name == "lt")
+        out += '<';
+    else if(name == "gt")
+        out += '>';
+    else if(name == "amp")
+        out += '&';
+    else if(name == "quot")
+        out += '"';
+    else if(name == "apos")
+        out += '\'';
+    else if(name.startsWith('#'))
+    {
+        bool       ok = false;
+        const uint code =
+            name.startsWith("#x") ? name.mid(2).toUInt(&ok, 16) :
+                                    name.mid(1).toUInt(&ok, 10);
+        if(ok) out += QString::fromUcs4(&code, 1);
+    }
+}
+
+QString
+LazyText::toString() const
+{
+    if(isEmpty()) return {};
+
+    const char* const begin = p_store->data() + m_offset;
+    const char* const end   = begin + m_size;
+
+    if(!m_escaped) return QString::fromUtf8(begin, static_cast<int>(m_size));
+
+    static const char        cdata_open[]  = "<![CDATA[";
+    static const char        cdata_close[] = "]]>";
+    constexpr std::ptrdiff_t cdata_len = sizeof(cdata_open) - 1;
+
+    QString out;
+    out.reserve(static_cast<int>(m_size));
+
+    // multibyte UTF-8 sequences never contain the special characters, so
+    // the plain runs between them are safe to decode separately
+    const char* run   = begin;
+    const auto  flush = [&](const char* c)
+    { out += QString::fromUtf8(run, static_cast<int>(c - run)); };
+
+    for(const char* c = begin; c != end; ++c)
+    {
+        if(*c == '&')
+        {
+            const char* semi = std::find(c, end, ';');
+            if(semi == end) continue;
+            flush(c);
+            append_entity(out, c + 1, semi);
+            c   = semi;
+            run = c + 1;
+        }
+        else if(*c == '\r')
+        {
+            flush(c);
+            out += '\n';
+            if(c + 1 != end && c[1] == '\n') ++c;
+            run = c + 1;
+        }
+        else if(*c == '<' && end - c >= cdata_len &&
+                std::memcmp(c, cdata_open, cdata_len) == 0)
+        {
+            flush(c);
+            const char* data_begin = c + cdata_len;
+            const char* data_end =
+                std::search(data_begin, end, cdata_close, cdata_close + 3);
+            out +=
+                QString::fromUtf8(data_begin,
+                                  static_cast<int>(data_end - data_begin));
+            c   = data_end == end ? end - 1 : data_end + 2;
+            run = c + 1;
+        }
+    }
+    flush(end);
+
+    return out;
+}
@@ -0,0 +1,107 @@
+// -*- C++ -*-
+// textstore.hpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include <memory>
+#include <utility>
+
+// Read-only bytes of a file. The file is memory mapped when the platform
+// allows it, otherwise it is read into a buffer, which holds less than
+// 2 GiB. Offsets are 64 bit, readers take the bytes through a device
+// rather than a QByteArray of the whole.
+class TextStore
+{
+    QFile       m_file;
+    QByteArray  m_buffer;
+    const char* p_data = nullptr;
+    qint64      m_size = 0;
+
+  public:
+    explicit TextStore(const QString& path);
+
+    // holds the bytes in memory, as if read from a file
+    explicit TextStore(QByteArray bytes);
+
+    TextStore(const TextStore&) = delete;
+
+    TextStore&
+    operator=(const TextStore&) = delete;
+
+    bool
+    isValid() const noexcept
+    {
+        return p_data != nullptr;
+    }
+
+    bool
+    isMapped() const noexcept
+    {
+        return isValid() && m_buffer.isNull();
+    }
+
+    const char*
+    data() const noexcept
+    {
+        return p_data;
+    }
+
+    qint64
+    size() const noexcept
+    {
+        return m_size;
+    }
+};
+
+// Span of a TextStore decoded only when it is asked for. Escaped spans hold
+// raw XML character data: entities and line ends are resolved on decoding.
+// A span itself is shorter than 2 GiB, as the QString it decodes to.
+class LazyText
+{
+    std::shared_ptr<const TextStore> p_store;
+    qint64                           m_offset  = 0;
+    quint32                          m_size    = 0;
+    bool                             m_escaped = false;
+
+  public:
+    LazyText() = default;
+
+    LazyText(std::shared_ptr<const TextStore> store,
+             const qint64                     offset,
+             const quint32                    size,
+             const bool                       escaped) noexcept :
+        p_store(std::move(store)),
+        m_offset(offset),
+        m_size(size),
+        m_escaped(escaped)
+    {
+    }
+
+    bool
+    isEmpty() const noexcept
+    {
+        return m_size == 0;
+    }
+
+    QString
+    toString() const;
+};
@@ -0,0 +1,117 @@
+// -*- C++ -*-
+// trace.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "trace.hpp"
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+#include <QVector>
+
+namespace trace
+{
+std::atomic_bool active{false};
+
+namespace
+{
+struct Event
+{
+    const char* name;
+    qint64      start; // nanoseconds since the session start
+    qint64      duration;
+    quintptr    thread;
+};
+
+QElapsedTimer  clock;
+QMutex         events_mutex;
+QVector<Event> events;
+
+bool
+write_events(const QString& path)
+{
+    QJsonArray array;
+    {
+        QMutexLocker lock(&events_mutex);
+        for(const Event& e: events)
+        {
+            QJsonObject obj;
+            obj.insert("name", e.name);
+            obj.insert("ph", "X");
+            obj.insert("ts", static_cast<double>(e.start) / 1000.0);
+            obj.insert("dur", static_cast<double>(e.duration) / 1000.0);
+            obj.insert("pid", 1);
+            obj.insert("tid", static_cast<qint64>(e.thread));
+            array.append(obj);
+        }
+    }
+
+    QJsonObject trace;
+    trace.insert("traceEvents", array);
+    trace.insert("displayTimeUnit", "ms");
+
+    QSaveFile file(path);
+    return file.open(QIODevice::WriteOnly) &&
+           file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact)) !=
+               -1 &&
+           file.commit();
+}
+} // namespace
+
+Scope::Scope(const char* name) noexcept
+{
+    if(!enabled()) return;
+
+    p_name  = name;
+    m_start = clock.nsecsElapsed();
+}
+
+Scope::~Scope()
+{
+    if(!p_name) return;
+
+    const qint64   end    = clock.nsecsElapsed();
+    const quintptr thread = reinterpret_cast<quintptr>(
+        QThread::currentThreadId());
+
+    QMutexLocker lock(&events_mutex);
+    events.append({p_name, m_start, end - m_start, thread});
+}
+
+Session::Session(const QString& path) : m_path(path)
+{
+    if(m_path.isEmpty()) return;
+
+    events.reserve(1 << 16);
+    clock.start();
+    active.store(true);
+}
+
+Session::~Session()
+{
+    if(m_path.isEmpty()) return;
+
+    active.store(false);
+    if(!write_events(m_path))
+        qWarning("Could not write trace %s", qUtf8Printable(m_path));
+}
+} // namespace trace
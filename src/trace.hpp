@@ -0,0 +1,79 @@
+// -*- C++ -*-
+// trace.hpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+#include <atomic>
+
+// Scoped tracing of phases for finding where the time goes. Scopes record
+// complete events only while a session is active, otherwise a scope costs
+// an atomic load. The session writes the events as a Chrome trace, which
+// chrome://tracing and Perfetto open.
+namespace trace
+{
+extern std::atomic_bool active;
+
+inline bool
+enabled() noexcept
+{
+    return active.load(std::memory_order_relaxed);
+}
+
+// Records the duration of its lifetime under the name, which must be a
+// string literal.
+class Scope
+{
+    const char* p_name = nullptr;
+    qint64      m_start;
+
+  public:
+    explicit Scope(const char* name) noexcept;
+
+    Scope(const Scope&) = delete;
+
+    Scope&
+    operator=(const Scope&) = delete;
+
+    ~Scope();
+};
+
+// Records events while alive if the path is not empty and writes them to
+// the path at the end.
+class Session
+{
+    QString m_path;
+
+  public:
+    explicit Session(const QString& path);
+
+    Session(const Session&) = delete;
+
+    Session&
+    operator=(const Session&) = delete;
+
+    ~Session();
+};
+} // namespace trace
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name)                                                      \
+    const trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
@@ -0,0 +1,152 @@
+// -*- C++ -*-
+// trigram.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "trigram.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <utility>
+
+static const QChar separator('\n');
+
+static quint64
+trigram(const QChar* c) noexcept
+{
+    return quint64(c[0].unicode()) << 32 | quint64(c[1].unicode()) << 16 |
+           quint64(c[2].unicode());
+}
+
+TrigramIndex::TrigramIndex(const Intrinsics& intrinsics)
+{
+    m_texts.reserve(intrinsics.count());
+
+    for(int n = 0; n < intrinsics.count(); ++n)
+    {
+        const Intrinsic& i    = intrinsics[n];
+        QString          text = i.name;
+        for(const Instruction& ins: i.instructions)
+        {
+            text += separator;
+            text += ins.name;
+        }
+        text = text.toCaseFolded();
+
+        const QChar* c = text.constData();
+        for(int p = 0; p + 3 <= text.size(); ++p)
+        {
+            if(c[p] == separator || c[p + 1] == separator ||
+               c[p + 2] == separator)
+                continue;
+
+            QVector<int>& posting = m_postings[trigram(c + p)];
+            if(posting.isEmpty() || posting.back() != n) posting.append(n);
+        }
+
+        m_texts.append(std::move(text));
+    }
+
+    for(QVector<int>& posting: m_postings) posting.squeeze();
+}
+
+Bitset
+TrigramIndex::find(const QString& search) const
+{
+    return find(search, Bitset(m_texts.count(), true));
+}
+
+Bitset
+TrigramIndex::find(const QString&          search,
+                   const Bitset&           candidates,
+                   const std::atomic_bool* cancel) const
+{
+    Bitset ret(m_texts.count());
+
+    const QString folded = search.toCaseFolded();
+    if(folded.isEmpty()) return candidates;
+    if(folded.contains(separator)) return ret;
+
+    // checks the flag once per this many candidates
+    static constexpr int cancel_period = 1024;
+
+    int        checked   = 0;
+    bool       cancelled = false;
+    const auto verify    = [&](const int n)
+    {
+        if(cancelled) return;
+        if(cancel && ++checked % cancel_period == 0 && cancel->load())
+        {
+            cancelled = true;
+            return;
+        }
+        if(m_texts[n].contains(folded)) ret.set(n);
+    };
+
+    if(folded.size() < 3)
+    {
+        candidates.forEach(verify);
+        return ret;
+    }
+
+    QVector<const QVector<int>*> postings;
+    const QChar*                 c = folded.constData();
+    for(int p = 0; p + 3 <= folded.size(); ++p)
+    {
+        const auto it = m_postings.constFind(trigram(c + p));
+        if(it == m_postings.cend()) return ret;
+        postings.append(&it.value());
+    }
+
+    // intersect starting from the rarest trigram, repeated ones are next to
+    // each other after sorting
+    std::sort(postings.begin(),
+              postings.end(),
+              [](const QVector<int>* lhs, const QVector<int>* rhs)
+              {
+                  if(lhs->count() != rhs->count())
+                      return lhs->count() < rhs->count();
+                  return std::less<const QVector<int>*>()(lhs, rhs);
+              });
+    postings.erase(std::unique(postings.begin(), postings.end()),
+                   postings.end());
+
+    QVector<int> found;
+    found.reserve(postings.front()->count());
+    for(const int n: *postings.front())
+        if(candidates.test(n)) found.append(n);
+
+    QVector<int> next;
+    for(int p = 1; p < postings.count() && !found.isEmpty(); ++p)
+    {
+        next.clear();
+        std::set_intersection(found.cbegin(),
+                              found.cend(),
+                              postings[p]->cbegin(),
+                              postings[p]->cend(),
+                              std::back_inserter(next));
+        found.swap(next);
+    }
+
+    for(const int n: found)
+    {
+        verify(n);
+        if(cancelled) break;
+    }
+
+    return ret;
+}
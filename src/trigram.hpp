@@ -0,0 +1,57 @@
+// -*- C++ -*-
+// trigram.hpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "bitset.hpp"
+#include "parser.hpp"
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+
+// Case folded trigram index over the names of intrinsics and of their
+// instructions. Trigrams of a search string give a candidate set which is
+// then verified, searches shorter than a trigram scan all texts.
+class TrigramIndex
+{
+    // folded name and instruction names of every intrinsic, one per line
+    QVector<QString> m_texts;
+
+    // sorted positions of the intrinsics having the trigram
+    QHash<quint64, QVector<int>> m_postings;
+
+  public:
+    TrigramIndex() = default;
+
+    explicit TrigramIndex(const Intrinsics& intrinsics);
+
+    // intrinsics with the string in the name or an instruction name,
+    // ignoring the case
+    Bitset
+    find(const QString& search) const;
+
+    // Same as find but only checks the candidates. Stops early once the
+    // cancel flag is raised, the result is incomplete then.
+    Bitset
+    find(const QString&          search,
+         const Bitset&           candidates,
+         const std::atomic_bool* cancel = nullptr) const;
+};
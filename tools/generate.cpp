@@ -0,0 +1,86 @@
+// -*- C++ -*-
+// generate.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Writes synthetic intrinsics data for scaling tests:
+//
+//     miniguide_generate --scale 100 --seed 7 -o data-x100.xml
+
+#include "generator.hpp"
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QSaveFile>
+#include <QTextStream>
+
+#include <cstdio>
+
+int
+main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Writes synthetic intrinsics data resembling the real one.");
+    parser.addHelpOption();
+    const QCommandLineOption seed_opt(
+        "seed", "Seed of the random choices.", "seed", "1");
+    const QCommandLineOption scale_opt(
+        "scale", "Multiple of the real 7000 intrinsics.", "scale", "1");
+    const QCommandLineOption count_opt(
+        "count", "Intrinsics to write, overrides the scale.", "count");
+    const QCommandLineOption output_opt(
+        QStringList{"o", "output"}, "Output file, stdout if none.", "file");
+    parser.addOptions({seed_opt, scale_opt, count_opt, output_opt});
+    parser.process(app);
+
+    GeneratorOptions options;
+    options.seed = parser.value(seed_opt).toULongLong();
+    options.count =
+        parser.isSet(count_opt) ?
+            parser.value(count_opt).toLongLong() :
+            static_cast<qint64>(parser.value(scale_opt).toDouble() *
+                                options.count);
+
+    QTextStream err(stderr);
+
+    if(!parser.isSet(output_opt))
+    {
+        QFile out;
+        if(!out.open(stdout, QIODevice::WriteOnly) ||
+           !generate_data(&out, options))
+        {
+            err << "Could not write the data\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    QSaveFile out(parser.value(output_opt));
+    if(!out.open(QIODevice::WriteOnly) || !generate_data(&out, options) ||
+       !out.commit())
+    {
+        err << "Could not write " << out.fileName() << ": " << out.errorString()
+            << '\n';
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,588 @@
+// -*- C++ -*-
+// generator.cpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "generator.hpp"
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QXmlStreamWriter>
+
+#include <cstddef>
+
+namespace
+{
+// splitmix64, the standard distributions differ between libraries
+class Random
+{
+    quint64 m_state;
+
+  public:
+    explicit Random(const quint64 seed) noexcept : m_state(seed) {}
+
+    quint64
+    next() noexcept
+    {
+        quint64 z = (m_state += 0x9e3779b97f4a7c15ull);
+        z         = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z         = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    // in [0, n)
+    int
+    below(const int n) noexcept
+    {
+        return static_cast<int>(next() % static_cast<quint64>(n));
+    }
+
+    // true with the given percentage
+    bool
+    chance(const int percent) noexcept
+    {
+        return below(100) < percent;
+    }
+};
+
+template <typename T>
+struct Weighted
+{
+    T   value;
+    int weight;
+};
+
+template <typename T, std::size_t N>
+const T&
+pick(Random& random, const Weighted<T> (&table)[N]) noexcept
+{
+    int total = 0;
+    for(const Weighted<T>& w: table) total += w.weight;
+
+    int n = random.below(total);
+    for(const Weighted<T>& w: table)
+        if((n -= w.weight) < 0) return w.value;
+
+    return table[N - 1].value;
+}
+
+enum class Family
+{
+    Vector, // packed operations on vector registers
+    SVML,   // math library sequences without an instruction
+    Scalar  // general purpose register operations
+};
+
+struct Tech
+{
+    const char* name;
+    Family      family;
+};
+
+struct Width
+{
+    const char* prefix;
+    const char* reg;
+    const char* ps;
+    const char* pd;
+    const char* si;
+    int         bits;
+};
+
+struct Element
+{
+    const char* suffix;
+    const char* mnemonic;
+    int         bits;
+};
+
+struct Op
+{
+    const char* name;
+    const char* mnemonic;
+    const char* verb;
+    const char* category;
+    int         arity;
+};
+
+struct Cpuid
+{
+    const char* name;
+    const char* header;
+};
+
+// about the shares of the techs in the real data
+const Weighted<Tech> techs[]{
+    {{"AVX-512", Family::Vector}, 56},
+    {{"SVML", Family::SVML}, 11},
+    {{"SSE_ALL", Family::Vector}, 11},
+    {{"AVX_ALL", Family::Vector}, 10},
+    {{"MMX", Family::Vector}, 2},
+    {{"Other", Family::Scalar}, 10}
+};
+
+const Width mmx_width{"_m_", "mm", "__m64", "__m64", "__m64", 64};
+const Width xmm_width{"_mm_", "xmm", "__m128", "__m128d", "__m128i", 128};
+const Width ymm_width{"_mm256_", "ymm", "__m256", "__m256d", "__m256i", 256};
+const Width zmm_width{"_mm512_", "zmm", "__m512", "__m512d", "__m512i", 512};
+
+const Weighted<Element> elements[]{
+    {{"ps", "PS", 32}, 20},
+    {{"pd", "PD", 64}, 15},
+    {{"epi8", "B", 8}, 8},
+    {{"epi16", "W", 16}, 10},
+    {{"epi32", "D", 32}, 15},
+    {{"epi64", "Q", 64}, 12},
+    {{"epu8", "UB", 8}, 4},
+    {{"epu16", "UW", 16}, 4},
+    {{"epu32", "UD", 32}, 5},
+    {{"epu64", "UQ", 64}, 3},
+    {{"ss", "SS", 32}, 2},
+    {{"sd", "SD", 64}, 2}
+};
+
+const Weighted<Op> vector_ops[]{
+    {{"add", "ADD", "Add", "Arithmetic", 2}, 10},
+    {{"sub", "SUB", "Subtract", "Arithmetic", 2}, 7},
+    {{"mul", "MUL", "Multiply", "Arithmetic", 2}, 6},
+    {{"div", "DIV", "Divide", "Arithmetic", 2}, 2},
+    {{"fmadd", "FMADD231", "Multiply and add", "Arithmetic", 3}, 4},
+    {{"max", "MAX", "Compare for the maximum of",
+      "Special Math Functions", 2}, 3},
+    {{"min", "MIN", "Compare for the minimum of",
+      "Special Math Functions", 2}, 3},
+    {{"abs", "ABS", "Compute the absolute value of",
+      "Special Math Functions", 1}, 2},
+    {{"and", "AND", "Compute the bitwise AND of", "Logical", 2}, 3},
+    {{"or", "OR", "Compute the bitwise OR of", "Logical", 2}, 3},
+    {{"xor", "XOR", "Compute the bitwise XOR of", "Logical", 2}, 3},
+    {{"cmpeq", "CMPEQ", "Compare for equality", "Compare", 2}, 4},
+    {{"cmpgt", "CMPGT", "Compare for greater-than", "Compare", 2}, 3},
+    {{"cvt", "CVT", "Convert", "Convert", 1}, 9},
+    {{"loadu", "MOVDQU", "Load", "Load", 1}, 6},
+    {{"storeu", "MOVDQU", "Store", "Store", 2}, 4},
+    {{"shuffle", "SHUF", "Shuffle", "Swizzle", 3}, 4},
+    {{"permutexvar", "PERM", "Permute", "Swizzle", 2}, 4},
+    {{"blend", "BLEND", "Blend", "Swizzle", 3}, 2},
+    {{"unpackhi", "UNPCKH", "Unpack and interleave", "Swizzle", 2}, 2},
+    {{"slli", "SLL", "Shift left", "Shift", 2}, 3},
+    {{"srli", "SRL", "Shift right", "Shift", 2}, 3},
+    {{"set1", "BROADCAST", "Broadcast", "Set", 1}, 3},
+    {{"sqrt", "SQRT", "Compute the square root of",
+      "Elementary Math Functions", 1}, 2},
+    {{"rcp14", "RCP14", "Compute the approximate reciprocal of",
+      "Elementary Math Functions", 1}, 1},
+    {{"popcnt", "POPCNT", "Count the set bits of", "Bit Manipulation", 1}, 1}
+};
+
+const Weighted<Op> svml_ops[]{
+    {{"sin", "", "Compute the sine of", "Trigonometry", 1}, 3},
+    {{"cos", "", "Compute the cosine of", "Trigonometry", 1}, 3},
+    {{"atan2", "", "Compute the inverse tangent of", "Trigonometry", 2}, 2},
+    {{"exp", "", "Compute the exponential value of",
+      "Elementary Math Functions", 1}, 3},
+    {{"log", "", "Compute the natural logarithm of",
+      "Elementary Math Functions", 1}, 3},
+    {{"pow", "", "Compute the exponential value of",
+      "Elementary Math Functions", 2}, 2},
+    {{"erf", "", "Compute the error function of", "Probability/Statistics",
+      1}, 2},
+    {{"cdfnorm", "", "Compute the cumulative distribution function of",
+      "Probability/Statistics", 1}, 1}
+};
+
+const Weighted<Op> scalar_ops[]{
+    {{"popcnt", "POPCNT", "Count the set bits of", "Bit Manipulation", 1}, 3},
+    {{"lzcnt", "LZCNT", "Count the leading zero bits of", "Bit Manipulation",
+      1}, 2},
+    {{"tzcnt", "TZCNT", "Count the trailing zero bits of",
+      "Bit Manipulation", 1}, 2},
+    {{"pdep", "PDEP", "Deposit contiguous low bits of", "Bit Manipulation",
+      2}, 2},
+    {{"pext", "PEXT", "Extract bits of", "Bit Manipulation", 2}, 2},
+    {{"rdrand", "RDRAND", "Read a hardware generated random value into",
+      "Random", 1}, 1},
+    {{"addcarry", "ADC", "Add with carry", "Arithmetic", 3}, 1},
+    {{"crc32", "CRC32", "Accumulate the CRC32 value of", "Cryptography", 2}, 2}
+};
+
+const Weighted<Cpuid> sse_cpuids[]{
+    {{"SSE", "xmmintrin.h"}, 20},
+    {{"SSE2", "emmintrin.h"}, 45},
+    {{"SSE3", "pmmintrin.h"}, 5},
+    {{"SSSE3", "tmmintrin.h"}, 5},
+    {{"SSE4.1", "smmintrin.h"}, 15},
+    {{"SSE4.2", "nmmintrin.h"}, 5}
+};
+
+const Weighted<Cpuid> avx_cpuids[]{
+    {{"AVX", "immintrin.h"}, 40},
+    {{"AVX2", "immintrin.h"}, 45},
+    {{"FMA", "immintrin.h"}, 10},
+    {{"F16C", "immintrin.h"}, 5}
+};
+
+const Weighted<Cpuid> avx512_cpuids[]{
+    {{"AVX512F", "immintrin.h"}, 45},
+    {{"AVX512BW", "immintrin.h"}, 15},
+    {{"AVX512DQ", "immintrin.h"}, 10},
+    {{"AVX512_FP16", "immintrin.h"}, 12},
+    {{"AVX512_BF16", "immintrin.h"}, 3},
+    {{"AVX512IFMA52", "immintrin.h"}, 2},
+    {{"AVX512_VBMI2", "immintrin.h"}, 5},
+    {{"AVX512CD", "immintrin.h"}, 3},
+    {{"AVX512_BITALG", "immintrin.h"}, 2},
+    {{"AVX512_VPOPCNTDQ", "immintrin.h"}, 3}
+};
+
+const Weighted<Cpuid> scalar_cpuids[]{
+    {{"POPCNT", "nmmintrin.h"}, 2},
+    {{"LZCNT", "immintrin.h"}, 2},
+    {{"BMI1", "immintrin.h"}, 3},
+    {{"BMI2", "immintrin.h"}, 3},
+    {{"RDRAND", "immintrin.h"}, 1},
+    {{"ADX", "immintrin.h"}, 1},
+    {{"SSE4.2", "nmmintrin.h"}, 1}
+};
+
+const Weighted<int> instruction_counts[]{
+    {1, 92},
+    {2, 5},
+    {3, 2},
+    {0, 1}
+};
+
+// One intrinsic being made up
+struct Record
+{
+    QString     tech;
+    QString     name;
+    QString     category;
+    QStringList cpuids;
+    QString     header;
+    QString     ret;
+    QStringList parm_types;
+    QStringList parm_names;
+    QString     description;
+    QString     operation;
+    QStringList instruction_names;
+    QString     form;
+};
+
+QString
+vector_type(const Width& width, const Element& element)
+{
+    const QString suffix(element.suffix);
+    if(suffix == "ps" || suffix == "ss") return width.ps;
+    if(suffix == "pd" || suffix == "sd") return width.pd;
+    return width.si;
+}
+
+QString
+operation_text(const Op&      op,
+               const int      lanes,
+               const int      bits,
+               const bool     masked,
+               const bool     zeroing,
+               const int      width_bits,
+               const QString& args)
+{
+    const QString lane("dst[i+%1:i]");
+    const QString element = lane.arg(bits - 1);
+
+    QString ret = QString("FOR j := 0 to %1\n\ti := j*%2\n").arg(lanes - 1)
+                      .arg(bits);
+
+    const QString value =
+        QString("%1(%2)").arg(QString(op.mnemonic).isEmpty() ?
+                                  QString(op.name).toUpper() :
+                                  QString(op.mnemonic),
+                              args);
+
+    if(masked)
+        ret += QString("\tIF k[j]\n\t\t%1 := %2\n\tELSE\n\t\t%1 := %3\n\tFI\n")
+                   .arg(element,
+                        value,
+                        zeroing ? QString("0") :
+                                  QString("src[i+%1:i]").arg(bits - 1));
+    else
+        ret += QString("\t%1 := %2\n").arg(element, value);
+
+    ret += "ENDFOR\n";
+    if(width_bits < 512) ret += QString("dst[MAX:%1] := 0\n").arg(width_bits);
+
+    return ret;
+}
+
+Record
+vector_record(Random& random, const Tech& tech)
+{
+    Record ret;
+    ret.tech = tech.name;
+
+    const bool avx512 = ret.tech == "AVX-512";
+    const bool svml   = tech.family == Family::SVML;
+
+    const Width* width = &xmm_width;
+    if(ret.tech == "MMX")
+    {
+        width = &mmx_width;
+        ret.cpuids.append("MMX");
+        ret.header = "mmintrin.h";
+    }
+    else if(ret.tech == "SSE_ALL")
+    {
+        const Cpuid& cpuid = pick(random, sse_cpuids);
+        ret.cpuids.append(cpuid.name);
+        ret.header = cpuid.header;
+    }
+    else if(ret.tech == "AVX_ALL")
+    {
+        const Cpuid& cpuid = pick(random, avx_cpuids);
+        width              = random.chance(80) ? &ymm_width : &xmm_width;
+        ret.cpuids.append(cpuid.name);
+        ret.header = cpuid.header;
+    }
+    else if(avx512)
+    {
+        const Cpuid& cpuid = pick(random, avx512_cpuids);
+        ret.cpuids.append(cpuid.name);
+        ret.header = cpuid.header;
+        if(random.chance(40))
+        {
+            width = random.chance(50) ? &ymm_width : &xmm_width;
+            ret.cpuids.append("AVX512VL");
+        }
+        else
+            width = &zmm_width;
+    }
+    else
+    {
+        const int w = random.below(3);
+        width       = w == 0 ? &xmm_width : w == 1 ? &ymm_width : &zmm_width;
+        ret.cpuids.append(w == 0 ? "SSE" : w == 1 ? "AVX" : "AVX512F");
+        ret.header = "immintrin.h";
+    }
+
+    const Op& op = svml ? pick(random, svml_ops) : pick(random, vector_ops);
+    ret.category = op.category;
+
+    Element element = pick(random, elements);
+    if(width == &mmx_width)
+        element = Element{"pi16", "W", 16};
+    else if(svml)
+        element = random.chance(50) ? Element{"ps", "PS", 32} :
+                                      Element{"pd", "PD", 64};
+
+    const QString type  = vector_type(*width, element);
+    const int     lanes = qMax(1, width->bits / element.bits);
+    const QString mask_type = QString("__mmask%1").arg(qMax(8, lanes));
+
+    // AVX-512 operations come with merge and zero masked variants
+    const int  variant = avx512 && !svml ? random.below(4) : 0;
+    const bool masked  = variant >= 2;
+    const bool zeroing = variant == 3;
+
+    ret.name = QString(width->prefix) + (masked ? zeroing ? "maskz_" : "mask_" :
+                                                  "") +
+               op.name + '_' + element.suffix;
+
+    if(masked && !zeroing)
+    {
+        ret.parm_types.append(type);
+        ret.parm_names.append("src");
+    }
+    if(masked)
+    {
+        ret.parm_types.append(mask_type);
+        ret.parm_names.append("k");
+    }
+
+    static const char* const operand_names[]{"a", "b", "c"};
+    QStringList              args;
+    for(int n = 0; n < op.arity; ++n)
+    {
+        const bool imm = n == 2 && op.arity == 3 && QString(op.name) != "fmadd";
+        ret.parm_types.append(imm ? "const int" : type);
+        ret.parm_names.append(imm ? "imm8" : operand_names[n]);
+        args.append(imm ? QString("imm8") :
+                          QString("%1[i+%2:i]")
+                              .arg(operand_names[n])
+                              .arg(element.bits - 1));
+    }
+
+    const QString category(op.category);
+    if(category == "Store")
+        ret.ret = "void";
+    else if(category == "Compare" && avx512)
+        ret.ret = mask_type;
+    else
+        ret.ret = type;
+
+    QString operands;
+    for(int n = 0; n < op.arity; ++n)
+        operands += QString(n == 0 ? "\"%1\"" : ", \"%1\"")
+                        .arg(ret.parm_names[ret.parm_names.count() - op.arity +
+                                            n]);
+
+    ret.description =
+        QString("%1 packed %2-bit elements in %3, and store the results in "
+                "\"dst\"")
+            .arg(op.verb)
+            .arg(element.bits)
+            .arg(operands);
+    if(masked)
+        ret.description +=
+            zeroing ? " using zeromask \"k\" (elements are zeroed out when "
+                      "the corresponding mask bit is not set)" :
+                      " using writemask \"k\" (elements are copied from "
+                      "\"src\" when the corresponding mask bit is not set)";
+    ret.description += '.';
+
+    ret.operation = operation_text(
+        op, lanes, element.bits, masked, zeroing, width->bits, args.join(", "));
+
+    if(!svml)
+    {
+        const QString stem = QString(width->bits > 128 || avx512 ? "V" : "") +
+                             (QString(element.suffix).startsWith("ep") ? "P" :
+                                                                         "") +
+                             op.mnemonic + element.mnemonic;
+        const int count = pick(random, instruction_counts);
+        for(int n = 0; n < count; ++n)
+            ret.instruction_names.append(n == 0 ? stem :
+                                                  stem + QString::number(n));
+
+        QStringList form;
+        form.append(QString(width->reg) + (masked ? " {k}" : ""));
+        for(int n = 0; n < op.arity; ++n) form.append(width->reg);
+        ret.form = form.join(", ");
+    }
+
+    return ret;
+}
+
+Record
+scalar_record(Random& random, const Tech& tech)
+{
+    Record ret;
+    ret.tech = tech.name;
+
+    const Op&    op    = pick(random, scalar_ops);
+    const Cpuid& cpuid = pick(random, scalar_cpuids);
+    const bool   wide  = random.chance(50);
+    const char*  type  = wide ? "unsigned __int64" : "unsigned int";
+
+    ret.name     = QString("_%1_u%2").arg(op.name).arg(wide ? 64 : 32);
+    ret.category = op.category;
+    ret.cpuids.append(cpuid.name);
+    ret.header = cpuid.header;
+    ret.ret    = type;
+
+    static const char* const operand_names[]{"a", "b", "c"};
+    for(int n = 0; n < op.arity; ++n)
+    {
+        ret.parm_types.append(type);
+        ret.parm_names.append(operand_names[n]);
+    }
+
+    ret.description =
+        QString("%1 unsigned %2-bit integer \"a\", and return the result.")
+            .arg(op.verb)
+            .arg(wide ? 64 : 32);
+    ret.operation = QString("dst := %1(a)\n").arg(op.mnemonic);
+    ret.instruction_names.append(op.mnemonic);
+    ret.form = wide ? "r64, r64" : "r32, r32";
+
+    return ret;
+}
+
+void
+write_record(QXmlStreamWriter& xml, const Record& record)
+{
+    xml.writeStartElement("intrinsic");
+    xml.writeAttribute("tech", record.tech);
+    xml.writeAttribute("name", record.name);
+
+    xml.writeEmptyElement("return");
+    xml.writeAttribute("type", record.ret);
+    xml.writeAttribute("varname", "dst");
+
+    for(int n = 0; n < record.parm_types.count(); ++n)
+    {
+        xml.writeEmptyElement("parameter");
+        xml.writeAttribute("type", record.parm_types[n]);
+        xml.writeAttribute("varname", record.parm_names[n]);
+    }
+
+    xml.writeTextElement("description", record.description);
+    xml.writeTextElement("operation", record.operation);
+
+    for(const QString& name: record.instruction_names)
+    {
+        xml.writeEmptyElement("instruction");
+        xml.writeAttribute("name", name);
+        xml.writeAttribute("form", record.form);
+        xml.writeAttribute("xed", name + '_' + record.form.toUpper());
+    }
+
+    for(const QString& cpuid: record.cpuids)
+        xml.writeTextElement("CPUID", cpuid);
+
+    xml.writeTextElement("header", record.header);
+    xml.writeTextElement("category", record.category);
+
+    xml.writeEndElement();
+}
+} // namespace
+
+bool
+generate_data(QIODevice* device, const GeneratorOptions& options)
+{
+    Random random(options.seed);
+
+    QXmlStreamWriter xml(device);
+    xml.setAutoFormatting(true);
+    xml.setAutoFormattingIndent(-1);
+
+    xml.writeStartDocument();
+    xml.writeStartElement("intrinsics_list");
+    xml.writeAttribute("version", "3.6.6");
+    xml.writeAttribute("date", QString("synthetic, seed %1").arg(options.seed));
+
+    // the combinations repeat past the real scale, the repeated names get
+    // a number as namesakes would flood the lookups
+    QHash<QString, int> names;
+
+    for(qint64 n = 0; n < options.count && !xml.hasError(); ++n)
+    {
+        const Tech& tech   = pick(random, techs);
+        Record      record = tech.family == Family::Scalar ?
+                                 scalar_record(random, tech) :
+                                 vector_record(random, tech);
+
+        int& seen = names[record.name + ' ' + record.tech];
+        if(seen++ > 0) record.name += QString("_%1").arg(seen - 1);
+
+        write_record(xml, record);
+    }
+
+    xml.writeEndElement();
+    xml.writeEndDocument();
+
+    return !xml.hasError();
+}
@@ -0,0 +1,39 @@
+// -*- C++ -*-
+// generator.hpp
+//
+//    Copyright (C) 2023  Roman Saldygashev
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <QIODevice>
+#include <QtGlobal>
+
+// Synthetic intrinsics data in the format of the Intrinsics Guide. The
+// techs, CPUIDs, categories, types, parameter and instruction counts are
+// drawn from weighted tables resembling the real data, so the scale of
+// the data can be raised well past the real 7k intrinsics. The same seed
+// and count give the same document on every platform.
+struct GeneratorOptions
+{
+    quint64 seed = 1;
+
+    // intrinsics to write, the real data has about 7000
+    qint64 count = 7000;
+};
+
+// writes the document, false on a write error
+bool
+generate_data(QIODevice* device, const GeneratorOptions& options);